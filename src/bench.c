@@ -0,0 +1,588 @@
+//! \file bench.c
+//!
+//! Micro and macro benchmarks for the led/msg libraries.
+//!
+//! Every benchmark runs a timed loop in batches. Each batch gives the mean time
+//! per operation of that batch, from these the median and the 99th percentile
+//! as well as the throughput (based on the median) are calculated. The 99th
+//! percentile is the one of the batch means (e.g. batches slowed down by
+//! interrupts), not the latency of single operations, which are too short to
+//! time individually.
+//!
+//! The results are written as CSV to standard out (one line per benchmark),
+//! a human readable table is written to standard error.
+//!
+//! ```sh
+//! ./bench [variant] [filter]
+//! ```
+//!
+//! - `variant`: Label written into the `variant` column (e.g. `static`).
+//! - `filter`: Only run benchmarks whose name contains this string.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "led.h"
+#include "led_apply.h"
+#include "led_atomic.h"
+#include "led_bank.h"
+#include "led_pack.h"
+#include "led_snapshot.h"
+#include "msg.h"
+#include "msg_queue.h"
+#include "registers.h"
+#include "workload.h"
+
+/// Number of timed batches per benchmark.
+#define BENCH_SAMPLES 201
+/// Minimum duration of a single batch in nanoseconds (used for calibration).
+#define BENCH_MIN_BATCH_NS 200000
+/// Number of messages in the generated message streams.
+#define BENCH_MESSAGES 4096
+/// Number of leds of a frame for the pack/unpack benchmarks.
+#define BENCH_PACK_LEDS (256 * 1024)
+/// Number of leds of the registers of the apply benchmarks.
+#define BENCH_APPLY_LEDS (4 * 1024 * 1024)
+/// Maximum number of updates of a frame of the apply benchmarks.
+#define BENCH_APPLY_UPDATES (BENCH_APPLY_LEDS / 4 + BENCH_APPLY_LEDS / 16)
+
+// Exported by led.c, but not part of the public interface.
+uint8_t set_bits(uint8_t lhs, uint8_t rhs, uint8_t mask);
+
+/// A single benchmark.
+typedef struct {
+	/// Name of the benchmark (`<unit>/<case>`).
+	const char* name;
+	/// Runs `iterations` iterations of the benchmark.
+	///
+	/// @return The number of operations done (usually `iterations`).
+	size_t (*run)(size_t iterations);
+} Bench;
+
+/// Sink for results which must not be optimized away.
+volatile uint8_t bench_sink;
+
+/// A message of a generated message stream.
+typedef struct {
+	/// Length of the message.
+	uint8_t length;
+	/// The message.
+	uint8_t data[MSG_FRAME_MAX_LENGTH + 1];
+} BenchMessage;
+
+/// Realistic mix of valid messages (#WORKLOAD_MIX_VALID).
+BenchMessage bench_messages_valid[BENCH_MESSAGES];
+/// Realistic mix of valid and invalid messages (#WORKLOAD_MIX_MIXED).
+BenchMessage bench_messages_mixed[BENCH_MESSAGES];
+/// The valid messages serialized back-to-back (for the stream decoder).
+uint8_t bench_stream[BENCH_MESSAGES * (MSG_FRAME_MAX_LENGTH + 1)];
+/// Number of used bytes in bench_stream.
+size_t bench_stream_length;
+/// Locations of the mixed messages (for the batch processing).
+MsgBatchEntry bench_batch_mixed[BENCH_MESSAGES];
+
+/// Frame (structure of arrays) for the pack/unpack benchmarks.
+uint8_t bench_pack_state[BENCH_PACK_LEDS];
+uint8_t bench_pack_color[BENCH_PACK_LEDS];
+uint8_t bench_pack_brightness[BENCH_PACK_LEDS];
+/// Packed register bytes of the frame.
+uint8_t bench_pack_packed[BENCH_PACK_LEDS];
+
+/// State of the generator of the benchmark data (see workload_random()).
+uint32_t bench_random_state = 0x2545f491;
+
+/// Fills the message buffers used by the benchmarks.
+void bench_generate_messages(void) {
+	for (size_t i = 0; i < BENCH_MESSAGES; i++) {
+		BenchMessage* valid = &bench_messages_valid[i];
+		BenchMessage* mixed = &bench_messages_mixed[i];
+
+		valid->length = workload_message(&bench_random_state, WORKLOAD_MIX_VALID, valid->data, NULL);
+		mixed->length = workload_message(&bench_random_state, WORKLOAD_MIX_MIXED, mixed->data, NULL);
+	}
+
+	for (size_t i = 0; i < BENCH_MESSAGES; i++) {
+		bench_batch_mixed[i] = (MsgBatchEntry){
+			(uint32_t)(i * sizeof(BenchMessage) + offsetof(BenchMessage, data)),
+			bench_messages_mixed[i].length,
+		};
+	}
+
+	// Streams are framed by op code, messages with a wrong length can not be
+	// expressed in a stream. So the valid mix is used.
+	for (size_t i = 0; i < BENCH_MESSAGES; i++) {
+		BenchMessage* message = &bench_messages_valid[i];
+
+		memcpy(&bench_stream[bench_stream_length], message->data, message->length);
+		bench_stream_length += message->length;
+	}
+}
+
+/// Fills the frame of the pack/unpack benchmarks with random values.
+void bench_generate_frame(void) {
+	for (size_t i = 0; i < BENCH_PACK_LEDS; i++) {
+		uint32_t random = workload_random(&bench_random_state);
+
+		bench_pack_state[i]      = random & 0x1;
+		bench_pack_color[i]      = (random >> 8) & 0x7;
+		bench_pack_brightness[i] = (random >> 16) & 0xf;
+	}
+}
+
+/// Registers of the apply benchmarks.
+uint8_t bench_apply_registers[BENCH_APPLY_LEDS];
+/// Frame of the apply benchmarks.
+LedUpdate bench_apply_updates[BENCH_APPLY_UPDATES];
+/// Number of updates in `bench_apply_updates`.
+size_t bench_apply_count;
+
+/// Fills the frame of the apply benchmarks with random updates.
+///
+/// The density is uneven: every led of the first quarter of the registers
+/// is updated, only every 16th led of the rest.
+void bench_generate_updates(void) {
+	for (size_t led = 0; led < BENCH_APPLY_LEDS; led += led < BENCH_APPLY_LEDS / 4 ? 1 : 16) {
+		uint32_t random = workload_random(&bench_random_state);
+
+		bench_apply_updates[bench_apply_count++] = (LedUpdate){
+			.led   = (uint32_t)led,
+			.mask  = LED_COLOR_MASK | LED_BRIGHTNESS_MASK,
+			.value = (uint8_t)random,
+		};
+	}
+}
+
+/*
+ * Benchmarks
+ */
+
+size_t bench_set_bits(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		// Through the sink, so inlined (lto) calls can not be folded away.
+		bench_sink = set_bits(bench_sink, (uint8_t)i, LED_COLOR_MASK);
+	}
+
+	return iterations;
+}
+
+size_t bench_led_state_on(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		led_state_on();
+	}
+
+	return iterations;
+}
+
+size_t bench_led_color_set(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		led_color_set((uint8_t)i);
+	}
+
+	return iterations;
+}
+
+size_t bench_led_color_red(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		led_color_red();
+	}
+
+	return iterations;
+}
+
+size_t bench_led_brightness_set(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		led_brightness_set((uint8_t)i);
+	}
+
+	return iterations;
+}
+
+size_t bench_led_transaction(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		led_begin();
+		led_color_set((uint8_t)i);
+		led_brightness_set((uint8_t)(i >> 3));
+		led_commit();
+	}
+
+	return iterations;
+}
+
+size_t bench_led_atomic_color_set(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		led_atomic_color_set((uint8_t)i);
+	}
+
+	return iterations;
+}
+
+size_t bench_led_bank_settings_set_range(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		led_bank_settings_set_range(0, LED_BANK_SIZE, (uint8_t)i, (uint8_t)(i >> 3));
+	}
+
+	return iterations * LED_BANK_SIZE;
+}
+
+size_t bench_led_bank_settings_set_loop(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		for (size_t led = 0; led < LED_BANK_SIZE; led++) {
+			led_bank_color_set(led, (uint8_t)i);
+			led_bank_brightness_set(led, (uint8_t)(i >> 3));
+		}
+	}
+
+	return iterations * LED_BANK_SIZE;
+}
+
+size_t bench_process_message_on(size_t iterations) {
+	uint8_t message[] = { MSG_OP_CODE_ON };
+
+	for (size_t i = 0; i < iterations; i++) {
+		bench_sink = process_message(sizeof(message), message);
+	}
+
+	return iterations;
+}
+
+size_t bench_process_message_settings(size_t iterations) {
+	uint8_t message[] = { MSG_OP_CODE_LED_SETTINGS, LED_COLOR_GREEN, 0x7 };
+
+	for (size_t i = 0; i < iterations; i++) {
+		message[2] = (uint8_t)i;
+		bench_sink = process_message(sizeof(message), message);
+	}
+
+	return iterations;
+}
+
+size_t bench_process_message_invalid(size_t iterations) {
+	uint8_t message[] = { 0xff };
+
+	for (size_t i = 0; i < iterations; i++) {
+		bench_sink = process_message(sizeof(message), message);
+	}
+
+	return iterations;
+}
+
+size_t bench_process_message_valid_mix(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		BenchMessage* message = &bench_messages_valid[i % BENCH_MESSAGES];
+		bench_sink = process_message(message->length, message->data);
+	}
+
+	return iterations;
+}
+
+size_t bench_process_message_mixed(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		BenchMessage* message = &bench_messages_mixed[i % BENCH_MESSAGES];
+		bench_sink = process_message(message->length, message->data);
+	}
+
+	return iterations;
+}
+
+size_t bench_process_messages_mixed(size_t iterations) {
+	const uint8_t* buffer = (const uint8_t*)bench_messages_mixed;
+
+	for (size_t i = 0; i < iterations; i++) {
+		bench_sink = (uint8_t)process_messages(buffer, bench_batch_mixed, BENCH_MESSAGES, NULL, NULL, 0);
+	}
+
+	return iterations * BENCH_MESSAGES;
+}
+
+size_t bench_msg_stream_process(size_t iterations) {
+	MsgStream stream;
+	size_t frames = 0;
+
+	msg_stream_init(&stream);
+
+	for (size_t i = 0; i < iterations; i++) {
+		frames += msg_stream_process(&stream, bench_stream_length, bench_stream, NULL);
+	}
+
+	return frames;
+}
+
+size_t bench_msg_queue(size_t iterations) {
+	static MsgQueue queue;
+	size_t processed = 0;
+
+	msg_queue_init(&queue);
+
+	for (size_t i = 0; i < iterations; i++) {
+		BenchMessage* message = &bench_messages_mixed[i % BENCH_MESSAGES];
+		msg_queue_enqueue(&queue, message->length, message->data);
+
+		if (msg_queue_size(&queue) == MSG_QUEUE_CAPACITY) {
+			processed += msg_queue_drain(&queue, MSG_QUEUE_CAPACITY, NULL);
+		}
+	}
+
+	processed += msg_queue_drain(&queue, MSG_QUEUE_CAPACITY, NULL);
+
+	return processed;
+}
+
+/// Packs the frame led by led with set_bits() (the way without led_pack).
+size_t bench_pack_naive(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		for (size_t led = 0; led < BENCH_PACK_LEDS; led++) {
+			uint8_t value = set_bits(0, bench_pack_state[led] << LED_STATE_OFFSET, LED_STATE_MASK);
+			value = set_bits(value, bench_pack_color[led] << LED_COLOR_OFFSET, LED_COLOR_MASK);
+			value = set_bits(value, bench_pack_brightness[led] << LED_BRIGHTNESS_OFFSET, LED_BRIGHTNESS_MASK);
+
+			bench_pack_packed[led] = value;
+		}
+	}
+
+	bench_sink = bench_pack_packed[BENCH_PACK_LEDS - 1];
+
+	return iterations * BENCH_PACK_LEDS;
+}
+
+/// Packs the frame with an implementation.
+///
+/// @return The number of packed leds (`0` if the implementation is not supported).
+size_t bench_pack(LedPackImplementation implementation, size_t iterations) {
+	if (!led_pack_select(implementation)) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < iterations; i++) {
+		led_pack(BENCH_PACK_LEDS, bench_pack_state, bench_pack_color, bench_pack_brightness, bench_pack_packed);
+	}
+
+	bench_sink = bench_pack_packed[BENCH_PACK_LEDS - 1];
+
+	return iterations * BENCH_PACK_LEDS;
+}
+
+/// Unpacks the frame with an implementation.
+///
+/// @return The number of unpacked leds (`0` if the implementation is not supported).
+size_t bench_unpack(LedPackImplementation implementation, size_t iterations) {
+	if (!led_pack_select(implementation)) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < iterations; i++) {
+		led_unpack(BENCH_PACK_LEDS, bench_pack_packed, bench_pack_state, bench_pack_color, bench_pack_brightness);
+	}
+
+	bench_sink = bench_pack_state[BENCH_PACK_LEDS - 1];
+
+	return iterations * BENCH_PACK_LEDS;
+}
+
+size_t bench_pack_scalar(size_t iterations) {
+	return bench_pack(LED_PACK_SCALAR, iterations);
+}
+
+size_t bench_pack_sse2(size_t iterations) {
+	return bench_pack(LED_PACK_SSE2, iterations);
+}
+
+size_t bench_pack_avx2(size_t iterations) {
+	return bench_pack(LED_PACK_AVX2, iterations);
+}
+
+size_t bench_unpack_scalar(size_t iterations) {
+	return bench_unpack(LED_PACK_SCALAR, iterations);
+}
+
+size_t bench_unpack_sse2(size_t iterations) {
+	return bench_unpack(LED_PACK_SSE2, iterations);
+}
+
+size_t bench_unpack_avx2(size_t iterations) {
+	return bench_unpack(LED_PACK_AVX2, iterations);
+}
+
+/// Encodes snapshots of the full state (one operation per snapshot).
+size_t bench_snapshot_encode(size_t iterations) {
+	static uint8_t snapshot[LED_SNAPSHOT_SIZE];
+
+	for (size_t i = 0; i < iterations; i++) {
+		led_snapshot_encode(snapshot);
+	}
+
+	bench_sink = snapshot[LED_SNAPSHOT_SIZE - 1];
+
+	return iterations;
+}
+
+/// Applies the frame on the calling thread (one operation per update).
+size_t bench_apply_serial(size_t iterations) {
+	for (size_t i = 0; i < iterations; i++) {
+		led_apply_registers(bench_apply_registers, BENCH_APPLY_LEDS, bench_apply_updates, bench_apply_count);
+	}
+
+	bench_sink = bench_apply_registers[BENCH_APPLY_LEDS - 1];
+
+	return iterations * bench_apply_count;
+}
+
+/// Applies the frame with a pool of `threads` threads (one operation per update).
+///
+/// @return The number of applied updates (`0` if the pool could not be started).
+size_t bench_apply_parallel(size_t threads, size_t iterations) {
+	if (led_apply_pool_threads() != threads && !led_apply_pool_start(threads)) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < iterations; i++) {
+		led_apply_registers_parallel(bench_apply_registers, BENCH_APPLY_LEDS, bench_apply_updates, bench_apply_count);
+	}
+
+	bench_sink = bench_apply_registers[BENCH_APPLY_LEDS - 1];
+
+	return iterations * bench_apply_count;
+}
+
+size_t bench_apply_parallel_1(size_t iterations) {
+	return bench_apply_parallel(1, iterations);
+}
+
+size_t bench_apply_parallel_2(size_t iterations) {
+	return bench_apply_parallel(2, iterations);
+}
+
+size_t bench_apply_parallel_4(size_t iterations) {
+	return bench_apply_parallel(4, iterations);
+}
+
+size_t bench_apply_parallel_8(size_t iterations) {
+	return bench_apply_parallel(8, iterations);
+}
+
+size_t bench_apply_parallel_16(size_t iterations) {
+	return bench_apply_parallel(16, iterations);
+}
+
+/// All available benchmarks.
+const Bench benches[] = {
+	{ "led/set_bits",                    bench_set_bits },
+	{ "led/led_state_on",                bench_led_state_on },
+	{ "led/led_color_set",               bench_led_color_set },
+	{ "led/led_color_red",               bench_led_color_red },
+	{ "led/led_brightness_set",          bench_led_brightness_set },
+	{ "led/transaction",                 bench_led_transaction },
+	{ "led_atomic/led_atomic_color_set", bench_led_atomic_color_set },
+	{ "led_bank/settings_set_range",     bench_led_bank_settings_set_range },
+	{ "led_bank/settings_set_loop",      bench_led_bank_settings_set_loop },
+	{ "msg/process_message_on",          bench_process_message_on },
+	{ "msg/process_message_settings",    bench_process_message_settings },
+	{ "msg/process_message_invalid",     bench_process_message_invalid },
+	{ "msg/process_message_valid_mix",   bench_process_message_valid_mix },
+	{ "msg/process_message_mixed",       bench_process_message_mixed },
+	{ "msg/process_messages_mixed",      bench_process_messages_mixed },
+	{ "msg/msg_stream_process",          bench_msg_stream_process },
+	{ "msg_queue/enqueue_drain_mixed",   bench_msg_queue },
+	{ "led_pack/pack_naive_set_bits",    bench_pack_naive },
+	{ "led_pack/pack_scalar",            bench_pack_scalar },
+	{ "led_pack/pack_sse2",              bench_pack_sse2 },
+	{ "led_pack/pack_avx2",              bench_pack_avx2 },
+	{ "led_pack/unpack_scalar",          bench_unpack_scalar },
+	{ "led_pack/unpack_sse2",            bench_unpack_sse2 },
+	{ "led_pack/unpack_avx2",            bench_unpack_avx2 },
+	{ "led_snapshot/encode",             bench_snapshot_encode },
+	{ "led_apply/serial",                bench_apply_serial },
+	{ "led_apply/parallel_1",            bench_apply_parallel_1 },
+	{ "led_apply/parallel_2",            bench_apply_parallel_2 },
+	{ "led_apply/parallel_4",            bench_apply_parallel_4 },
+	{ "led_apply/parallel_8",            bench_apply_parallel_8 },
+	{ "led_apply/parallel_16",           bench_apply_parallel_16 },
+};
+
+/*
+ * Runner
+ */
+
+/// Comparison function for qsort() of doubles.
+int bench_compare_double(const void* lhs, const void* rhs) {
+	double a = *(const double*)lhs;
+	double b = *(const double*)rhs;
+
+	return (a > b) - (a < b);
+}
+
+/// Runs a benchmark and prints its results.
+///
+/// @param bench The benchmark to run.
+/// @param variant Label for the `variant` column.
+void bench_run(const Bench* bench, const char* variant) {
+	static double samples[BENCH_SAMPLES];
+	size_t iterations = 1;
+	size_t ops = 0;
+
+	// Calibrate the number of iterations per batch (also warms up caches).
+	for (;;) {
+		uint64_t start = workload_now_ns();
+		ops = bench->run(iterations);
+		uint64_t elapsed = workload_now_ns() - start;
+
+		// Not supported (e.g. by the cpu), skipped.
+		if (ops == 0) {
+			fprintf(stderr, "%-34s %-10s skipped\n", bench->name, variant);
+			return;
+		}
+
+		if (elapsed >= BENCH_MIN_BATCH_NS || iterations >= ((size_t)1 << 30)) {
+			break;
+		}
+
+		iterations *= 2;
+	}
+
+	for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+		uint64_t start = workload_now_ns();
+		ops = bench->run(iterations);
+		uint64_t elapsed = workload_now_ns() - start;
+
+		samples[i] = (double)elapsed / (double)(ops > 0 ? ops : 1);
+	}
+
+	qsort(samples, BENCH_SAMPLES, sizeof(samples[0]), bench_compare_double);
+
+	double median = samples[BENCH_SAMPLES / 2];
+	double p99_batch = samples[(BENCH_SAMPLES * 99) / 100];
+	double ops_per_sec = median > 0.0 ? 1e9 / median : 0.0;
+
+	printf("%s,%s,%zu,%d,%.3f,%.3f,%.0f\n", bench->name, variant, ops, BENCH_SAMPLES, median, p99_batch, ops_per_sec);
+	fprintf(stderr, "%-34s %-10s %12.3f ns/op (p99 batch mean %12.3f) %16.0f ops/s\n", bench->name, variant, median, p99_batch, ops_per_sec);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+	const char* variant = argc > 1 ? argv[1] : "default";
+	const char* filter  = argc > 2 ? argv[2] : NULL;
+
+	led_init();
+	led_bank_init();
+	bench_generate_messages();
+	bench_generate_frame();
+	bench_generate_updates();
+
+	printf("name,variant,ops_per_batch,samples,median_ns_per_op,p99_batch_mean_ns_per_op,ops_per_sec\n");
+
+	for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		if (filter != NULL && strstr(benches[i].name, filter) == NULL) {
+			continue;
+		}
+
+		bench_run(&benches[i], variant);
+	}
+
+	led_apply_pool_stop();
+
+	return 0;
+}
@@ -0,0 +1,65 @@
+//! \file board.h
+//!
+//! Description of the led register of each supported board.
+//!
+//! The board is selected at compile time by the target controller, which the
+//! Makefile defines (`-D'$(TARGET_MC)'`). All values are constants, so the
+//! offsets and masks in led.h fold into the code of each build.
+//!
+//! | Board         | Leds | State | Color | Brightness |
+//! | ------------- | ---- | ----- | ----- | ---------- |
+//! | `STM32F767ZI` | `3`  | `0`   | `3..1`| `7..4`     |
+//! | `STM32L162`   | `1`  | `0`   | `3..1`| `7..4`     |
+//! | `SIMULATOR`   | `1`  | `7`   | `6..4`| `3..0`     |
+//!
+//! Other (or no) target controllers use the default layout of the STM32
+//! boards with a single led. `SIMULATOR` is a host only target with the
+//! sections in reversed order, which verifies that nothing depends on the
+//! default layout.
+//!
+//! # Adding a board
+//!
+//! Add a branch which defines all `LED_BOARD_*` values below and add the
+//! board to `BOARDS` in the Makefile (see `make test-boards`).
+//!
+//! # NOTE
+//! The register is 8bit on all boards; the width of the sections is given by
+//! their values (state 1bit, color 3bit, brightness 4bit), only their
+//! offsets differ between boards.
+
+#ifndef _BOARD_H_
+#define _BOARD_H_
+
+#if defined STM32F767ZI
+/// Name of the board.
+#define LED_BOARD_NAME              "STM32F767ZI"
+/// Number of leds on the board.
+#define LED_BOARD_LEDS              3
+/// Bit offset of the state section.
+#define LED_BOARD_STATE_OFFSET      0
+/// Bit offset of the color section.
+#define LED_BOARD_COLOR_OFFSET      1
+/// Bit offset of the brightness section.
+#define LED_BOARD_BRIGHTNESS_OFFSET 4
+#elif defined STM32L162
+#define LED_BOARD_NAME              "STM32L162"
+#define LED_BOARD_LEDS              1
+#define LED_BOARD_STATE_OFFSET      0
+#define LED_BOARD_COLOR_OFFSET      1
+#define LED_BOARD_BRIGHTNESS_OFFSET 4
+#elif defined SIMULATOR
+#define LED_BOARD_NAME              "SIMULATOR"
+#define LED_BOARD_LEDS              1
+#define LED_BOARD_STATE_OFFSET      7
+#define LED_BOARD_COLOR_OFFSET      4
+#define LED_BOARD_BRIGHTNESS_OFFSET 0
+#else
+// Default layout (no or an unknown target controller).
+#define LED_BOARD_NAME              "default"
+#define LED_BOARD_LEDS              1
+#define LED_BOARD_STATE_OFFSET      0
+#define LED_BOARD_COLOR_OFFSET      1
+#define LED_BOARD_BRIGHTNESS_OFFSET 4
+#endif
+
+#endif
@@ -3,10 +3,44 @@
 //!
 //! See led.h for the available functions and documentation.
 
+#include <stdbool.h>
 #include <stdint.h>
 
+// The library always provides the out of line functions.
+#undef LED_INLINE
+
 #include "registers.h"
 #include "led.h"
+#include "stats.h"
+#include "trace.h"
+
+_Static_assert((LED_STATE_MASK | LED_COLOR_MASK | LED_BRIGHTNESS_MASK) <= 0xff, "The led register sections of the board must fit into 8bit");
+_Static_assert((LED_STATE_MASK & LED_COLOR_MASK) == 0 && (LED_STATE_MASK & LED_BRIGHTNESS_MASK) == 0 && (LED_COLOR_MASK & LED_BRIGHTNESS_MASK) == 0, "The led register sections of the board must not overlap");
+
+/*
+ * Instrumentation
+ */
+
+#if defined LED_STATS || defined LED_TRACE
+/// Defined if the library is built with `LED_STATS` or `LED_TRACE` (checked by led_inline.h).
+const uint8_t led_library_instrumented = 1;
+#else
+/// Defined if the library is built without instrumentation (checked by led_inline.h).
+const uint8_t led_library_plain = 1;
+#endif
+
+/*
+ * Transaction state
+ */
+
+/// Nesting depth of the open transactions (`0` if none is open).
+uint8_t led_transaction_depth;
+/// Cached copy of the led register while a transaction is open.
+uint8_t led_shadow;
+/// Value of the led register when the outermost transaction was started.
+uint8_t led_shadow_base;
+/// Bits of the shadow which where set during the transaction.
+uint8_t led_shadow_mask;
 
 /*
  * Utilities
@@ -27,20 +61,78 @@ uint8_t set_bits(uint8_t lhs, uint8_t rhs, uint8_t mask) {
 	return (lhs & ~mask) | (rhs & mask);
 }
 
+/// Writes `value` to the led register.
+///
+/// This is the only place where the led register is written.
+///
+/// @param value The new value of the led register.
+/// @param mask The bits which where set by the caller (for tracing).
+void led_register_write(uint8_t value, uint8_t mask) {
+	STATS_REGISTER_WRITE();
+	TRACE_REGISTER_WRITE(value, mask);
+
+	registers_write_begin();
+	LED = value;
+	registers_write_end();
+}
+
 /// Sets the specified bits of the led register.
 /// See set_bits() for more information.
 ///
 /// # NOTE
-/// This is the same as calling:
+/// Outside of a transaction, this is the same as calling:
 /// ```c
 /// LED = set_bits(LED, rhs, mask);
 /// ```
+/// Inside of a transaction only the shadow is modified.
 void set_led_bits(uint8_t rhs, uint8_t mask) {
-	LED = set_bits(LED, rhs, mask);
+	if (led_transaction_depth > 0) {
+		led_shadow       = set_bits(led_shadow, rhs, mask);
+		led_shadow_mask |= mask;
+	} else {
+		led_register_write(set_bits(LED, rhs, mask), mask);
+	}
 }
 
 void led_clear(void) {
-	LED = 0x00;
+	if (led_transaction_depth > 0) {
+		led_shadow      = 0x00;
+		led_shadow_mask = 0xff;
+	} else {
+		led_register_write(0x00, 0xff);
+	}
+}
+
+void led_value_set(uint8_t value) {
+	set_led_bits(value, 0xff);
+}
+
+uint8_t led_value(void) {
+	return led_transaction_depth > 0 ? led_shadow : LED;
+}
+
+void led_begin(void) {
+	if (led_transaction_depth++ == 0) {
+		led_shadow_base = LED;
+		led_shadow      = led_shadow_base;
+		led_shadow_mask = 0x00;
+	}
+}
+
+bool led_commit(void) {
+	if (led_transaction_depth == 0 || --led_transaction_depth > 0) {
+		return false;
+	}
+
+	// Write elision; the register is known to still hold the base value.
+	if (led_shadow == led_shadow_base) {
+		STATS_REGISTER_WRITE_ELIDED();
+		return false;
+	}
+
+	led_register_write(led_shadow, led_shadow_mask);
+
+	return true;
 }
 
 void led_init(void) {
@@ -53,7 +145,7 @@ void led_init(void) {
 
 void led_state_set(LedState state) {
 	// Keep in valid/expected bounds
-	uint8_t safe_state = state & LED_STATE_MASK;
+	uint8_t safe_state = (state & LED_STATE_VALUE_MASK) << LED_STATE_OFFSET;
 
 	set_led_bits(safe_state, LED_STATE_MASK);
 }
@@ -1,6 +1,6 @@
 //! \file led.h
 //!
-//! Led Register Layout (8bit):
+//! Led Register Layout (8bit, default):
 //!
 //! ```txt
 //! +------------+-------+-------+
@@ -9,6 +9,12 @@
 //! <--- 4bit ---|<- 3bit|<- 1bit|
 //!     7..4       3..1     0
 //! ```
+//!
+//! The offsets of the sections depend on the board (see board.h).
+//!
+//! Defining `LED_INLINE` before including this file (e.g. `-DLED_INLINE`)
+//! replaces the state/color/brightness setters with header only `static
+//! inline` variants (see led_inline.h).
 
 #ifndef _LED_H_
 #define _LED_H_
@@ -16,22 +22,28 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "board.h"
+
+/// Bit offset of the state section
+#define LED_STATE_OFFSET     LED_BOARD_STATE_OFFSET
+/// Bit mask of the state value (apply to constrain the value to valid values)
+#define LED_STATE_VALUE_MASK 0x1 // 1 / 0b1
 /// Bit mask for the state section
-#define LED_STATE_MASK 0x1
+#define LED_STATE_MASK       (LED_STATE_VALUE_MASK << LED_STATE_OFFSET) // 0b0000_0001 (default layout)
 
 /// Bit offset of the color section
-#define LED_COLOR_OFFSET     0x1 // 1
+#define LED_COLOR_OFFSET     LED_BOARD_COLOR_OFFSET
 /// Bit mask of the color value (apply to constrain the value to valid values)
 #define LED_COLOR_VALUE_MASK 0x7 // 7 / 0b111
 /// Bit mask for the color section
-#define LED_COLOR_MASK       LED_COLOR_VALUE_MASK << LED_COLOR_OFFSET // 0b0000_1110
+#define LED_COLOR_MASK       (LED_COLOR_VALUE_MASK << LED_COLOR_OFFSET) // 0b0000_1110 (default layout)
 
 /// Bit offset of the brightness section
-#define LED_BRIGHTNESS_OFFSET     0x4 // 4
+#define LED_BRIGHTNESS_OFFSET     LED_BOARD_BRIGHTNESS_OFFSET
 /// Bit mask of the brightness value (apply to constrain the value to valid values)
 #define LED_BRIGHTNESS_VALUE_MASK 0xf // 15 / 0b1111
 /// Bit mask for the brightness section
-#define LED_BRIGHTNESS_MASK       LED_BRIGHTNESS_VALUE_MASK << LED_BRIGHTNESS_OFFSET // 0b1111_0000
+#define LED_BRIGHTNESS_MASK       (LED_BRIGHTNESS_VALUE_MASK << LED_BRIGHTNESS_OFFSET) // 0b1111_0000 (default layout)
 /// Minimum allowed value for brightness
 #define LED_BRIGHTNESS_MIN        0x0 // 0
 /// Maximum allowed value for brightness
@@ -69,6 +81,49 @@ void led_init(void);
 /// Clears all relevant bits from the led.
 void led_clear(void);
 
+/// Sets all bits of the led register (state, color and brightness) at once.
+///
+/// @param value The new value of the led register.
+void led_value_set(uint8_t value);
+
+/// Returns the value of the led register.
+///
+/// Inside of a transaction the value of the shadow (including the changes of
+/// the transaction) is returned.
+///
+/// @return The value of the led register.
+uint8_t led_value(void);
+
+/// Starts a transaction on the led register.
+///
+/// Until the matching led_commit(), all `led_*` functions of this unit only
+/// modify a cached copy (shadow) of the register instead of the register
+/// itself. Transactions can be nested, only the outermost led_commit() writes
+/// the register.
+///
+/// # Example
+/// ```c
+/// led_begin();
+/// led_color_set(LED_COLOR_RED);
+/// led_brightness_max();
+/// led_commit(); // single register write
+/// ```
+void led_begin(void);
+
+/// Ends a transaction started with led_begin().
+///
+/// When the outermost transaction is committed, the shadow is written to the
+/// register with a single store. The write is skipped if the shadow equals the
+/// value the register had when the transaction was started.
+///
+/// @return `true` if the register was written, `false` otherwise.
+bool led_commit(void);
+
+#ifdef LED_INLINE
+// Header only variants of the functions below (see led_inline.h).
+#include "led_inline.h"
+#else
+
 /// Sets the state of the led.
 ///
 /// @param state The new state for the led (1bit).
@@ -166,3 +221,5 @@ void led_brightness_min(void);
 void led_brightness_max(void);
 
 #endif
+
+#endif
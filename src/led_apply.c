@@ -0,0 +1,340 @@
+//! \file led_apply.c
+//! Implementation for the (parallel) frame apply.
+//!
+//! See led_apply.h for the available functions and documentation.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <threads.h>
+
+#include "led_apply.h"
+#include "led_bank.h"
+#include "registers.h"
+
+_Static_assert(LED_APPLY_SHARD_LEDS % LED_APPLY_CACHE_LINE == 0, "LED_APPLY_SHARD_LEDS must be a multiple of LED_APPLY_CACHE_LINE");
+
+/// Shards of a single thread which are not applied yet.
+///
+/// The range `next..end` is packed into one word (`next` in the low, `end`
+/// in the high 32bit), the owner takes shards from the front, other threads
+/// steal from the back. Each queue has its own cache line.
+typedef struct {
+	_Alignas(LED_APPLY_CACHE_LINE) _Atomic uint64_t shards;
+} LedApplyQueue;
+
+/// Frame which is currently applied by the pool.
+typedef struct {
+	/// The registers.
+	uint8_t* registers;
+	/// The number of registers.
+	size_t leds;
+	/// The updates (sorted by led).
+	const LedUpdate* updates;
+	/// The number of updates.
+	size_t count;
+	/// Offset of the registers from the previous cache line boundary.
+	size_t misalignment;
+} LedApplyFrame;
+
+/// Worker threads of the pool.
+thrd_t led_apply_workers[LED_APPLY_MAX_THREADS - 1];
+/// Number of threads applying a frame, including the caller (`1` if no pool is running).
+size_t led_apply_threads = 1;
+/// Protects `led_apply_generation` and `led_apply_stopping`.
+mtx_t led_apply_lock;
+/// Signals a new frame (or stopping) to the workers.
+cnd_t led_apply_start;
+/// Number of the current frame.
+uint64_t led_apply_generation;
+/// `true` while the pool is stopped.
+bool led_apply_stopping;
+/// The current frame.
+LedApplyFrame led_apply_frame;
+/// Shards of each thread (index `0` is the caller).
+LedApplyQueue led_apply_queues[LED_APPLY_MAX_THREADS];
+/// Number of workers which did not finish the current frame (the barrier).
+_Alignas(LED_APPLY_CACHE_LINE) atomic_size_t led_apply_pending;
+
+/// Returns the index of the first update of a led at or after `led`.
+///
+/// @param updates The updates (sorted by led).
+/// @param count The number of updates.
+/// @param led The led.
+///
+/// @return The index of the update (`count` if there is none).
+size_t led_apply_lower_bound(const LedUpdate* updates, size_t count, size_t led) {
+	size_t first = 0;
+
+	while (count > 0) {
+		size_t half = count / 2;
+
+		if (updates[first + half].led < led) {
+			first += half + 1;
+			count -= half + 1;
+		} else {
+			count = half;
+		}
+	}
+
+	return first;
+}
+
+/// Applies the updates of a range of leds.
+///
+/// @param registers The registers.
+/// @param first The first led of the range.
+/// @param last The led after the range.
+/// @param updates The updates (sorted by led).
+/// @param count The number of updates.
+void led_apply_range(uint8_t* registers, size_t first, size_t last, const LedUpdate* updates, size_t count) {
+	for (size_t i = led_apply_lower_bound(updates, count, first); i < count && updates[i].led < last; i++) {
+		const LedUpdate* update = &updates[i];
+
+		registers[update->led] = (registers[update->led] & ~update->mask) | (update->value & update->mask);
+	}
+}
+
+void led_apply_registers(uint8_t* registers, size_t leds, const LedUpdate* updates, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		const LedUpdate* update = &updates[i];
+
+		if (update->led < leds) {
+			registers[update->led] = (registers[update->led] & ~update->mask) | (update->value & update->mask);
+		}
+	}
+}
+
+/// Returns the first led of a shard of a frame.
+///
+/// All shards but the first start on a cache line boundary.
+///
+/// @param frame The frame.
+/// @param shard The shard.
+///
+/// @return The first led (the number of leds for the shard after the last one).
+size_t led_apply_shard_first(const LedApplyFrame* frame, size_t shard) {
+	if (shard == 0) {
+		return 0;
+	}
+
+	size_t first = shard * LED_APPLY_SHARD_LEDS - frame->misalignment;
+
+	return first < frame->leds ? first : frame->leds;
+}
+
+/// Takes the next own shard of a thread.
+///
+/// @param queue The queue of the thread.
+/// @param shard Receives the shard.
+///
+/// @return `true` if a shard was taken, `false` if the queue is empty.
+bool led_apply_pop(LedApplyQueue* queue, size_t* shard) {
+	uint64_t shards = atomic_load_explicit(&queue->shards, memory_order_relaxed);
+
+	do {
+		uint32_t next = shards & 0xffffffffu;
+		uint32_t end  = shards >> 32;
+
+		if (next >= end) {
+			return false;
+		}
+
+		*shard = next;
+	} while (!atomic_compare_exchange_weak_explicit(&queue->shards, &shards, shards + 1, memory_order_relaxed, memory_order_relaxed));
+
+	return true;
+}
+
+/// Steals the last shard of another thread.
+///
+/// @param queue The queue of the other thread.
+/// @param shard Receives the shard.
+///
+/// @return `true` if a shard was stolen, `false` if the queue is empty.
+bool led_apply_steal(LedApplyQueue* queue, size_t* shard) {
+	uint64_t shards = atomic_load_explicit(&queue->shards, memory_order_relaxed);
+
+	do {
+		uint32_t next = shards & 0xffffffffu;
+		uint32_t end  = shards >> 32;
+
+		if (next >= end) {
+			return false;
+		}
+
+		*shard = end - 1;
+	} while (!atomic_compare_exchange_weak_explicit(&queue->shards, &shards, shards - ((uint64_t)1 << 32), memory_order_relaxed, memory_order_relaxed));
+
+	return true;
+}
+
+/// Applies shards of the current frame until all queues are empty.
+///
+/// @param self The index of the calling thread.
+void led_apply_work(size_t self) {
+	const LedApplyFrame* frame = &led_apply_frame;
+	size_t shard;
+
+	for (;;) {
+		bool found = led_apply_pop(&led_apply_queues[self], &shard);
+
+		// Shards are never added during a frame, so the frame is done (for
+		// this thread) once all queues where seen empty.
+		for (size_t i = 1; !found && i < led_apply_threads; i++) {
+			found = led_apply_steal(&led_apply_queues[(self + i) % led_apply_threads], &shard);
+		}
+
+		if (!found) {
+			return;
+		}
+
+		led_apply_range(frame->registers, led_apply_shard_first(frame, shard), led_apply_shard_first(frame, shard + 1), frame->updates, frame->count);
+	}
+}
+
+/// Worker thread of the pool.
+///
+/// @param arg The index of the worker (as `uintptr_t`, `1` for the first).
+int led_apply_worker(void* arg) {
+	size_t self = (uintptr_t)arg;
+	uint64_t seen = 0;
+
+	for (;;) {
+		mtx_lock(&led_apply_lock);
+
+		while (led_apply_generation == seen && !led_apply_stopping) {
+			cnd_wait(&led_apply_start, &led_apply_lock);
+		}
+
+		seen = led_apply_generation;
+		bool stopping = led_apply_stopping;
+
+		mtx_unlock(&led_apply_lock);
+
+		if (stopping) {
+			return 0;
+		}
+
+		led_apply_work(self);
+		atomic_fetch_sub_explicit(&led_apply_pending, 1, memory_order_release);
+	}
+}
+
+void led_apply_registers_parallel(uint8_t* registers, size_t leds, const LedUpdate* updates, size_t count) {
+	size_t misalignment = (uintptr_t)registers % LED_APPLY_CACHE_LINE;
+	size_t shards = (leds + misalignment + LED_APPLY_SHARD_LEDS - 1) / LED_APPLY_SHARD_LEDS;
+
+	if (led_apply_threads < 2 || shards < 2 || shards > UINT32_MAX) {
+		led_apply_registers(registers, leds, updates, count);
+		return;
+	}
+
+	led_apply_frame = (LedApplyFrame){ registers, leds, updates, count, misalignment };
+
+	for (size_t i = 0; i < led_apply_threads; i++) {
+		uint64_t next = shards * i / led_apply_threads;
+		uint64_t end  = shards * (i + 1) / led_apply_threads;
+
+		atomic_store_explicit(&led_apply_queues[i].shards, next | end << 32, memory_order_relaxed);
+	}
+
+	atomic_store_explicit(&led_apply_pending, led_apply_threads - 1, memory_order_relaxed);
+
+	// Publishes the frame and the queues to the workers.
+	mtx_lock(&led_apply_lock);
+	led_apply_generation++;
+	cnd_broadcast(&led_apply_start);
+	mtx_unlock(&led_apply_lock);
+
+	led_apply_work(0);
+
+	// Barrier: pairs with the release of each worker, so all of their writes
+	// are visible once it passed.
+	while (atomic_load_explicit(&led_apply_pending, memory_order_acquire) != 0) {
+		thrd_yield();
+	}
+}
+
+void led_apply_bank(const LedUpdate* updates, size_t count) {
+	uint8_t* registers = led_bank_target_registers();
+	bool bank = registers == LED_BANK;
+
+	if (bank) {
+		registers_write_begin();
+	}
+
+	led_apply_registers_parallel(registers, LED_BANK_SIZE, updates, count);
+
+	if (bank) {
+		registers_write_end();
+	}
+}
+
+bool led_apply_pool_start(size_t threads) {
+	led_apply_pool_stop();
+
+	if (threads < 1 || threads > LED_APPLY_MAX_THREADS) {
+		return false;
+	}
+
+	if (threads == 1) {
+		return true;
+	}
+
+	if (mtx_init(&led_apply_lock, mtx_plain) != thrd_success) {
+		return false;
+	}
+
+	if (cnd_init(&led_apply_start) != thrd_success) {
+		mtx_destroy(&led_apply_lock);
+		return false;
+	}
+
+	led_apply_generation = 0;
+	led_apply_stopping = false;
+
+	for (size_t i = 1; i < threads; i++) {
+		if (thrd_create(&led_apply_workers[i - 1], led_apply_worker, (void*)(uintptr_t)i) != thrd_success) {
+			// Stops the workers created so far.
+			led_apply_threads = i;
+
+			if (i > 1) {
+				led_apply_pool_stop();
+			} else {
+				cnd_destroy(&led_apply_start);
+				mtx_destroy(&led_apply_lock);
+			}
+
+			return false;
+		}
+	}
+
+	led_apply_threads = threads;
+
+	return true;
+}
+
+void led_apply_pool_stop(void) {
+	if (led_apply_threads < 2) {
+		return;
+	}
+
+	mtx_lock(&led_apply_lock);
+	led_apply_stopping = true;
+	cnd_broadcast(&led_apply_start);
+	mtx_unlock(&led_apply_lock);
+
+	for (size_t i = 1; i < led_apply_threads; i++) {
+		thrd_join(led_apply_workers[i - 1], NULL);
+	}
+
+	cnd_destroy(&led_apply_start);
+	mtx_destroy(&led_apply_lock);
+	led_apply_threads = 1;
+}
+
+size_t led_apply_pool_threads(void) {
+	return led_apply_threads;
+}
@@ -0,0 +1,105 @@
+//! \file led_apply.h
+//!
+//! Applies frames of per led updates to a bank of led registers, optionally
+//! in parallel.
+//!
+//! A frame is a list of updates sorted by led, each of them sets the bits of
+//! a single led register which are selected by its mask (e.g.
+//! #LED_COLOR_MASK). led_apply_registers() applies a frame on the calling
+//! thread, led_apply_registers_parallel() splits the registers into shards
+//! and applies them with a pool of worker threads:
+//!
+//! ```c
+//! // During startup (4 threads, the caller and 3 workers)
+//! led_apply_pool_start(4);
+//!
+//! // Per frame
+//! led_apply_registers_parallel(registers, leds, updates, count);
+//! ```
+//!
+//! # Sharding
+//!
+//! Shards are #LED_APPLY_SHARD_LEDS consecutive registers whose boundaries
+//! are aligned to #LED_APPLY_CACHE_LINE bytes (the first and the last shard
+//! may be shorter), so no two threads ever write the same cache line. Every
+//! thread starts with an equal share of the shards and steals shards from the
+//! other threads once its own are done, which balances frames with an uneven
+//! density of updates. The caller takes part in the work and returns once
+//! all shards are applied (a single barrier per frame).
+//!
+//! # NOTE
+//! Updates of the same led are applied in order. Updates of leds outside of
+//! the registers are ignored. Only a single thread may apply frames with the
+//! pool at a time.
+
+#ifndef _LED_APPLY_H_
+#define _LED_APPLY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Size of a cache line in bytes.
+#define LED_APPLY_CACHE_LINE 64
+
+/// Number of leds of a shard (a multiple of #LED_APPLY_CACHE_LINE).
+#define LED_APPLY_SHARD_LEDS 4096
+
+/// Maximum number of threads of the pool (including the caller).
+#define LED_APPLY_MAX_THREADS 64
+
+/// Update of a single led register.
+typedef struct {
+	/// Index of the led.
+	uint32_t led;
+	/// Bits of the register to set (e.g. `LED_COLOR_MASK | LED_BRIGHTNESS_MASK`).
+	uint8_t mask;
+	/// New value of the bits (in the register layout, see led.h).
+	uint8_t value;
+} LedUpdate;
+
+/// Applies a frame of updates on the calling thread.
+///
+/// @param registers The registers.
+/// @param leds The number of registers.
+/// @param updates The updates (sorted by led).
+/// @param count The number of updates.
+void led_apply_registers(uint8_t* registers, size_t leds, const LedUpdate* updates, size_t count);
+
+/// Applies a frame of updates with the pool (see led_apply_pool_start()).
+///
+/// Same result as led_apply_registers(). Without a pool (or if the registers
+/// fit into a single shard) the frame is applied on the calling thread.
+///
+/// @param registers The registers.
+/// @param leds The number of registers.
+/// @param updates The updates (sorted by led).
+/// @param count The number of updates.
+void led_apply_registers_parallel(uint8_t* registers, size_t leds, const LedUpdate* updates, size_t count);
+
+/// Applies a frame of updates to the led bank with the pool.
+///
+/// Changes the registers of the led bank of the calling thread (see
+/// led_bank_target()), writes of #LED_BANK are a single write for
+/// registers_snapshot().
+///
+/// @param updates The updates (sorted by led).
+/// @param count The number of updates.
+void led_apply_bank(const LedUpdate* updates, size_t count);
+
+/// Starts the pool (stops a running pool first).
+///
+/// @param threads The number of threads which apply a frame, including the caller (`1` - #LED_APPLY_MAX_THREADS, `1` applies frames on the calling thread only).
+///
+/// @return `true` if the pool was started, `false` if `threads` is invalid or a thread could not be created (no pool is running).
+bool led_apply_pool_start(size_t threads);
+
+/// Stops the pool and joins its threads.
+void led_apply_pool_stop(void);
+
+/// Returns the number of threads of the pool.
+///
+/// @return The number of threads which apply a frame, including the caller (`1` if no pool is running).
+size_t led_apply_pool_threads(void);
+
+#endif
@@ -0,0 +1,104 @@
+//! \file led_atomic.c
+//! Implementation for the thread safe led interface.
+//!
+//! See led_atomic.h for the available functions and documentation.
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "registers.h"
+#include "led.h"
+#include "led_atomic.h"
+
+// The led register is a plain `uint8_t`, it is accessed through an atomic view.
+_Static_assert(sizeof(_Atomic uint8_t) == sizeof(uint8_t), "Atomic view of the led register has a different size");
+_Static_assert(ATOMIC_CHAR_LOCK_FREE == 2, "Atomic operations on the led register are not lock-free");
+
+/// Returns an atomic view of the led register.
+_Atomic uint8_t* led_atomic_register(void) {
+	return (_Atomic uint8_t*)&LED;
+}
+
+/// Atomically replaces the bits masked by `mask` of the led register with `rhs`.
+///
+/// Uses a compare-and-swap loop, so the other bits of the register are never
+/// changed, even if they are updated concurrently.
+///
+/// @param rhs Value to set bits from.
+/// @param mask Bit mask to indicate which bits to set.
+void set_led_bits_atomic(uint8_t rhs, uint8_t mask) {
+	_Atomic uint8_t* led = led_atomic_register();
+	uint8_t bits = rhs & mask;
+	uint8_t expected = atomic_load_explicit(led, memory_order_relaxed);
+
+	// On failure `expected` is reloaded with the current value.
+	while (!atomic_compare_exchange_weak_explicit(
+				led, &expected, (expected & ~mask) | bits,
+				memory_order_release, memory_order_relaxed)) {
+	}
+}
+
+void led_atomic_clear(void) {
+	atomic_store_explicit(led_atomic_register(), 0x00, memory_order_release);
+}
+
+/*
+ * STATE
+ */
+
+void led_atomic_state_set(LedState state) {
+	// A single bit can be set/cleared without a compare-and-swap loop.
+	if (state & LED_STATE_VALUE_MASK) {
+		atomic_fetch_or_explicit(led_atomic_register(), LED_STATE_MASK, memory_order_release);
+	} else {
+		atomic_fetch_and_explicit(led_atomic_register(), (uint8_t)~LED_STATE_MASK, memory_order_release);
+	}
+}
+
+void led_atomic_state_on(void) {
+	led_atomic_state_set(LED_STATE_ON);
+}
+
+void led_atomic_state_off(void) {
+	led_atomic_state_set(LED_STATE_OFF);
+}
+
+/*
+ * COLOR
+ */
+
+void led_atomic_color_set(uint8_t color) {
+	uint8_t safe_color = (color & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET;
+
+	set_led_bits_atomic(safe_color, LED_COLOR_MASK);
+}
+
+void led_atomic_color_red(void) {
+	led_atomic_color_set(LED_COLOR_RED);
+}
+
+void led_atomic_color_green(void) {
+	led_atomic_color_set(LED_COLOR_GREEN);
+}
+
+void led_atomic_color_blue(void) {
+	led_atomic_color_set(LED_COLOR_BLUE);
+}
+
+/*
+ * BRIGHTNESS
+ */
+
+void led_atomic_brightness_set(uint8_t brightness) {
+	uint8_t safe_brightness = (brightness & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET;
+
+	set_led_bits_atomic(safe_brightness, LED_BRIGHTNESS_MASK);
+}
+
+void led_atomic_brightness_min(void) {
+	led_atomic_brightness_set(LED_BRIGHTNESS_MIN);
+}
+
+void led_atomic_brightness_max(void) {
+	led_atomic_brightness_set(LED_BRIGHTNESS_MAX);
+}
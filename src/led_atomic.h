@@ -0,0 +1,117 @@
+//! \file led_atomic.h
+//!
+//! Thread safe variants of the led interface (see led.h).
+//!
+//! The functions of led.h modify the led register with a plain
+//! read-modify-write, so two threads changing different sections (e.g. color
+//! and brightness) at the same time can lose each others bits. The functions
+//! in this unit update the register with lock-free atomic operations instead,
+//! so concurrent updates of different sections never overwrite each other.
+//!
+//! # NOTE
+//! The atomic functions bypass led transactions (see led_begin()) and the
+//! instrumentation (see stats.h and trace.h). Mixing them with the functions
+//! of led.h from different threads is not thread safe.
+
+#ifndef _LED_ATOMIC_H_
+#define _LED_ATOMIC_H_
+
+#include <stdint.h>
+
+#include "led.h"
+
+/// Atomically clears all relevant bits from the led.
+void led_atomic_clear(void);
+
+/// Atomically sets the state of the led.
+///
+/// @param state The new state for the led (1bit).
+void led_atomic_state_set(LedState state);
+
+/// Atomically enables the led.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_atomic_state_set(LED_STATE_ON);
+/// ```
+void led_atomic_state_on(void);
+
+/// Atomically disables the led.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_atomic_state_set(LED_STATE_OFF);
+/// ```
+void led_atomic_state_off(void);
+
+/// Atomically sets the color(s) for the led.
+///
+/// @param color The color(s) to set the led to (3bit).
+///
+/// # NOTE
+/// Each call to this function will clear any existing set color bits.
+void led_atomic_color_set(uint8_t color);
+
+/// Atomically sets the color of the led to red.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_atomic_color_set(LED_COLOR_RED);
+/// ```
+void led_atomic_color_red(void);
+
+/// Atomically sets the color of the led to green.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_atomic_color_set(LED_COLOR_GREEN);
+/// ```
+void led_atomic_color_green(void);
+
+/// Atomically sets the color of the led to blue.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_atomic_color_set(LED_COLOR_BLUE);
+/// ```
+void led_atomic_color_blue(void);
+
+/// Atomically sets the brightness of the led.
+///
+/// @param brightness The brightness to set the led to (4bit).
+///
+/// # NOTE
+/// The value for brightness should be constraint to LED_BRIGHTNESS_MIN and LED_BRIGHTNESS_MAX.
+void led_atomic_brightness_set(uint8_t brightness);
+
+/// Atomically sets the brightness of the led to the minimum value.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_atomic_brightness_set(LED_BRIGHTNESS_MIN);
+/// ```
+void led_atomic_brightness_min(void);
+
+/// Atomically sets the brightness of the led to the maximum value.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_atomic_brightness_set(LED_BRIGHTNESS_MAX);
+/// ```
+void led_atomic_brightness_max(void);
+
+#endif
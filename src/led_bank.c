@@ -0,0 +1,283 @@
+//! \file led_bank.c
+//! Implementation for the led bank interface.
+//!
+//! See led_bank.h for the available functions and documentation.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "registers.h"
+#include "led.h"
+#include "led_bank.h"
+
+_Static_assert(LED_BANK_SIZE > 0, "LED_BANK_SIZE must not be zero");
+_Static_assert(LED_BANK_SIZE <= UINT16_MAX + 1, "LED_BANK_SIZE must be addressable by LedHandle");
+
+/// Bank which is changed by the functions of this unit (per thread, `NULL` for #LED_BANK).
+_Thread_local uint8_t* led_bank_registers;
+
+/*
+ * Utilities
+ */
+
+/// Starts a write to the bank of the calling thread.
+///
+/// Writes to #LED_BANK are enclosed in registers_write_begin() and
+/// registers_write_end(), other banks (e.g. frames) are written directly.
+///
+/// @return The registers to change.
+uint8_t* led_bank_write_begin(void) {
+	if (led_bank_registers != NULL) {
+		return led_bank_registers;
+	}
+
+	registers_write_begin();
+
+	return LED_BANK;
+}
+
+/// Ends a write started with led_bank_write_begin().
+void led_bank_write_end(void) {
+	if (led_bank_registers == NULL) {
+		registers_write_end();
+	}
+}
+
+/// Sets the bits masked by `mask` of a single led in the bank to `rhs`.
+///
+/// @param led The led to change.
+/// @param rhs Value to set bits from.
+/// @param mask Bit mask to indicate which bits to set.
+void set_bank_bits(LedHandle led, uint8_t rhs, uint8_t mask) {
+	if (led >= LED_BANK_SIZE) {
+		return;
+	}
+
+	uint8_t* leds = led_bank_write_begin();
+
+	leds[led] = (leds[led] & ~mask) | (rhs & mask);
+
+	led_bank_write_end();
+}
+
+/// Sets the bits masked by `mask` of `count` consecutive leds starting at
+/// `first` to `rhs`.
+///
+/// @param first The first led to change.
+/// @param count The number of leds to change.
+/// @param rhs Value to set bits from.
+/// @param mask Bit mask to indicate which bits to set.
+void set_bank_bits_range(LedHandle first, size_t count, uint8_t rhs, uint8_t mask) {
+	if (first >= LED_BANK_SIZE) {
+		return;
+	}
+
+	if (count > (size_t)LED_BANK_SIZE - first) {
+		count = LED_BANK_SIZE - first;
+	}
+
+	// Hoisted out of the loop, so the body is a plain and/or per register.
+	uint8_t* leds = &led_bank_write_begin()[first];
+	uint8_t keep  = ~mask;
+	uint8_t bits  = rhs & mask;
+
+	for (size_t i = 0; i < count; i++) {
+		leds[i] = (leds[i] & keep) | bits;
+	}
+
+	led_bank_write_end();
+}
+
+/// Sets the bits masked by `mask` of all leds selected by `led_mask` to `rhs`.
+///
+/// @param led_mask Selection of leds (#LED_BANK_MASK_SIZE bytes).
+/// @param rhs Value to set bits from.
+/// @param mask Bit mask to indicate which bits to set.
+void set_bank_bits_mask(const uint8_t* led_mask, uint8_t rhs, uint8_t mask) {
+	uint8_t* leds = led_bank_write_begin();
+	uint8_t bits = rhs & mask;
+
+	for (size_t byte = 0; byte < LED_BANK_MASK_SIZE; byte++) {
+		uint8_t selection = led_mask[byte];
+
+		// Skip whole groups of unselected leds (sparse masks).
+		if (selection == 0) {
+			continue;
+		}
+
+		size_t first = byte * 8;
+		size_t count = LED_BANK_SIZE - first < 8 ? LED_BANK_SIZE - first : 8;
+
+		for (size_t i = 0; i < count; i++) {
+			// 0x00 or 0xff depending on whether the led is selected.
+			uint8_t selected = -((selection >> i) & 0x1);
+			uint8_t led_bits = mask & selected;
+
+			leds[first + i] = (leds[first + i] & ~led_bits) | (bits & selected);
+		}
+	}
+
+	led_bank_write_end();
+}
+
+void led_bank_clear(void) {
+	uint8_t* leds = led_bank_write_begin();
+
+	for (size_t i = 0; i < LED_BANK_SIZE; i++) {
+		leds[i] = 0x00;
+	}
+
+	led_bank_write_end();
+}
+
+void led_bank_init(void) {
+	led_bank_clear();
+}
+
+/// Truncates a range of leds to the bank.
+///
+/// @param first The first led of the range.
+/// @param count The number of leds of the range.
+///
+/// @return The number of leds of the range which are part of the bank.
+size_t led_bank_range_count(LedHandle first, size_t count) {
+	if (first >= LED_BANK_SIZE) {
+		return 0;
+	}
+
+	return count > (size_t)LED_BANK_SIZE - first ? (size_t)LED_BANK_SIZE - first : count;
+}
+
+void led_bank_target(uint8_t* registers) {
+	led_bank_registers = registers != LED_BANK ? registers : NULL;
+}
+
+uint8_t* led_bank_target_registers(void) {
+	return led_bank_registers != NULL ? led_bank_registers : LED_BANK;
+}
+
+size_t led_bank_values_get(LedHandle first, size_t count, uint8_t* values) {
+	count = led_bank_range_count(first, count);
+
+	if (count > 0) {
+		memcpy(values, &led_bank_target_registers()[first], count);
+	}
+
+	return count;
+}
+
+void led_bank_values_set(LedHandle first, size_t count, const uint8_t* values) {
+	count = led_bank_range_count(first, count);
+
+	if (count > 0) {
+		memcpy(&led_bank_write_begin()[first], values, count);
+		led_bank_write_end();
+	}
+}
+
+/*
+ * STATE
+ */
+
+void led_bank_state_set(LedHandle led, LedState state) {
+	set_bank_bits(led, (state & LED_STATE_VALUE_MASK) << LED_STATE_OFFSET, LED_STATE_MASK);
+}
+
+void led_bank_state_on(LedHandle led) {
+	led_bank_state_set(led, LED_STATE_ON);
+}
+
+void led_bank_state_off(LedHandle led) {
+	led_bank_state_set(led, LED_STATE_OFF);
+}
+
+void led_bank_state_set_range(LedHandle first, size_t count, LedState state) {
+	set_bank_bits_range(first, count, (state & LED_STATE_VALUE_MASK) << LED_STATE_OFFSET, LED_STATE_MASK);
+}
+
+void led_bank_state_set_mask(const uint8_t* led_mask, LedState state) {
+	set_bank_bits_mask(led_mask, (state & LED_STATE_VALUE_MASK) << LED_STATE_OFFSET, LED_STATE_MASK);
+}
+
+/*
+ * COLOR
+ */
+
+void led_bank_color_set(LedHandle led, uint8_t color) {
+	uint8_t safe_color = (color & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET;
+
+	set_bank_bits(led, safe_color, LED_COLOR_MASK);
+}
+
+void led_bank_color_red(LedHandle led) {
+	led_bank_color_set(led, LED_COLOR_RED);
+}
+
+void led_bank_color_green(LedHandle led) {
+	led_bank_color_set(led, LED_COLOR_GREEN);
+}
+
+void led_bank_color_blue(LedHandle led) {
+	led_bank_color_set(led, LED_COLOR_BLUE);
+}
+
+void led_bank_color_set_range(LedHandle first, size_t count, uint8_t color) {
+	uint8_t safe_color = (color & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET;
+
+	set_bank_bits_range(first, count, safe_color, LED_COLOR_MASK);
+}
+
+void led_bank_color_set_mask(const uint8_t* led_mask, uint8_t color) {
+	uint8_t safe_color = (color & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET;
+
+	set_bank_bits_mask(led_mask, safe_color, LED_COLOR_MASK);
+}
+
+/*
+ * BRIGHTNESS
+ */
+
+void led_bank_brightness_set(LedHandle led, uint8_t brightness) {
+	uint8_t safe_brightness = (brightness & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET;
+
+	set_bank_bits(led, safe_brightness, LED_BRIGHTNESS_MASK);
+}
+
+void led_bank_brightness_min(LedHandle led) {
+	led_bank_brightness_set(led, LED_BRIGHTNESS_MIN);
+}
+
+void led_bank_brightness_max(LedHandle led) {
+	led_bank_brightness_set(led, LED_BRIGHTNESS_MAX);
+}
+
+void led_bank_brightness_set_range(LedHandle first, size_t count, uint8_t brightness) {
+	uint8_t safe_brightness = (brightness & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET;
+
+	set_bank_bits_range(first, count, safe_brightness, LED_BRIGHTNESS_MASK);
+}
+
+void led_bank_brightness_set_mask(const uint8_t* led_mask, uint8_t brightness) {
+	uint8_t safe_brightness = (brightness & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET;
+
+	set_bank_bits_mask(led_mask, safe_brightness, LED_BRIGHTNESS_MASK);
+}
+
+/*
+ * SETTINGS (color + brightness)
+ */
+
+void led_bank_settings_set_range(LedHandle first, size_t count, uint8_t color, uint8_t brightness) {
+	uint8_t safe_color      = (color & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET;
+	uint8_t safe_brightness = (brightness & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET;
+
+	set_bank_bits_range(first, count, safe_color | safe_brightness, LED_COLOR_MASK | LED_BRIGHTNESS_MASK);
+}
+
+void led_bank_settings_set_mask(const uint8_t* led_mask, uint8_t color, uint8_t brightness) {
+	uint8_t safe_color      = (color & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET;
+	uint8_t safe_brightness = (brightness & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET;
+
+	set_bank_bits_mask(led_mask, safe_color | safe_brightness, LED_COLOR_MASK | LED_BRIGHTNESS_MASK);
+}
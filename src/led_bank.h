@@ -0,0 +1,233 @@
+//! \file led_bank.h
+//!
+//! Handle based interface for the led register bank.
+//!
+//! The bank is a contiguous array of `LED_BANK_SIZE` led registers, each of
+//! them using the same layout as the single led (see led.h). A led in the
+//! bank is addressed by its index (#LedHandle).
+//!
+//! Besides the per led functions, bulk functions are provided which apply a
+//! state/color/brightness to a range of leds or to all leds selected by a
+//! bit mask in a single pass over the bank.
+//!
+//! # NOTE
+//! Handles outside of the bank are ignored. Ranges reaching past the end of
+//! the bank are truncated to the bank.
+
+#ifndef _LED_BANK_H_
+#define _LED_BANK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "led.h"
+#include "registers.h"
+
+/// Number of bytes needed for a led mask covering the whole bank.
+///
+/// Bit `n % 8` of byte `n / 8` selects the led with the handle `n`.
+#define LED_BANK_MASK_SIZE ((LED_BANK_SIZE + 7) / 8)
+
+/// Index of a led in the led bank.
+typedef uint16_t LedHandle;
+
+/// Initializes the led bank.
+/// This functions should be called before any other function from this unit.
+void led_bank_init(void);
+
+/// Clears all relevant bits from all leds in the bank.
+void led_bank_clear(void);
+
+/// Redirects all functions of this unit (for the calling thread) to another
+/// bank of #LED_BANK_SIZE registers, e.g. the back frame of led_frame.h.
+///
+/// @param registers The registers to change, `NULL` for #LED_BANK.
+void led_bank_target(uint8_t* registers);
+
+/// Returns the registers which are changed by the functions of this unit
+/// (for the calling thread).
+///
+/// @return The registers (#LED_BANK unless changed with led_bank_target()).
+uint8_t* led_bank_target_registers(void);
+
+/*
+ * Single led
+ */
+
+/// Sets the state of a led in the bank.
+///
+/// @param led The led to change.
+/// @param state The new state for the led (1bit).
+void led_bank_state_set(LedHandle led, LedState state);
+
+/// Enables a led in the bank.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_bank_state_set(led, LED_STATE_ON);
+/// ```
+void led_bank_state_on(LedHandle led);
+
+/// Disables a led in the bank.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_bank_state_set(led, LED_STATE_OFF);
+/// ```
+void led_bank_state_off(LedHandle led);
+
+/// Sets the color(s) of a led in the bank.
+///
+/// @param led The led to change.
+/// @param color The color(s) to set the led to (3bit).
+///
+/// # NOTE
+/// Each call to this function will clear any existing set color bits.
+void led_bank_color_set(LedHandle led, uint8_t color);
+
+/// Sets the color of a led in the bank to red.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_bank_color_set(led, LED_COLOR_RED);
+/// ```
+void led_bank_color_red(LedHandle led);
+
+/// Sets the color of a led in the bank to green.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_bank_color_set(led, LED_COLOR_GREEN);
+/// ```
+void led_bank_color_green(LedHandle led);
+
+/// Sets the color of a led in the bank to blue.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_bank_color_set(led, LED_COLOR_BLUE);
+/// ```
+void led_bank_color_blue(LedHandle led);
+
+/// Sets the brightness of a led in the bank.
+///
+/// @param led The led to change.
+/// @param brightness The brightness to set the led to (4bit).
+///
+/// # NOTE
+/// The value for brightness should be constraint to LED_BRIGHTNESS_MIN and LED_BRIGHTNESS_MAX.
+void led_bank_brightness_set(LedHandle led, uint8_t brightness);
+
+/// Sets the brightness of a led in the bank to the minimum value.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_bank_brightness_set(led, LED_BRIGHTNESS_MIN);
+/// ```
+void led_bank_brightness_min(LedHandle led);
+
+/// Sets the brightness of a led in the bank to the maximum value.
+///
+/// # NOTE
+/// This is the same as calling:
+///
+/// ```c
+/// led_bank_brightness_set(led, LED_BRIGHTNESS_MAX);
+/// ```
+void led_bank_brightness_max(LedHandle led);
+
+/// Copies the registers of `count` consecutive leds starting at `first` into
+/// `values`.
+///
+/// @param first The first led to copy.
+/// @param count The number of leds to copy.
+/// @param values Receives the registers (`count` bytes).
+///
+/// @return The number of copied leds (truncated to the bank).
+size_t led_bank_values_get(LedHandle first, size_t count, uint8_t* values);
+
+/// Sets the registers of `count` consecutive leds starting at `first` to
+/// `values` in a single bulk copy.
+///
+/// @param first The first led to change.
+/// @param count The number of leds to change.
+/// @param values The new registers (`count` bytes).
+void led_bank_values_set(LedHandle first, size_t count, const uint8_t* values);
+
+/*
+ * Ranges
+ */
+
+/// Sets the state of `count` consecutive leds starting at `first`.
+///
+/// @param first The first led to change.
+/// @param count The number of leds to change.
+/// @param state The new state for the leds (1bit).
+void led_bank_state_set_range(LedHandle first, size_t count, LedState state);
+
+/// Sets the color(s) of `count` consecutive leds starting at `first`.
+///
+/// @param first The first led to change.
+/// @param count The number of leds to change.
+/// @param color The color(s) to set the leds to (3bit).
+void led_bank_color_set_range(LedHandle first, size_t count, uint8_t color);
+
+/// Sets the brightness of `count` consecutive leds starting at `first`.
+///
+/// @param first The first led to change.
+/// @param count The number of leds to change.
+/// @param brightness The brightness to set the leds to (4bit).
+void led_bank_brightness_set_range(LedHandle first, size_t count, uint8_t brightness);
+
+/// Sets the color(s) and brightness of `count` consecutive leds starting at
+/// `first` in a single pass.
+///
+/// @param first The first led to change.
+/// @param count The number of leds to change.
+/// @param color The color(s) to set the leds to (3bit).
+/// @param brightness The brightness to set the leds to (4bit).
+void led_bank_settings_set_range(LedHandle first, size_t count, uint8_t color, uint8_t brightness);
+
+/*
+ * Masks
+ */
+
+/// Sets the state of all leds selected by `led_mask`.
+///
+/// @param led_mask Selection of leds (#LED_BANK_MASK_SIZE bytes).
+/// @param state The new state for the leds (1bit).
+void led_bank_state_set_mask(const uint8_t* led_mask, LedState state);
+
+/// Sets the color(s) of all leds selected by `led_mask`.
+///
+/// @param led_mask Selection of leds (#LED_BANK_MASK_SIZE bytes).
+/// @param color The color(s) to set the leds to (3bit).
+void led_bank_color_set_mask(const uint8_t* led_mask, uint8_t color);
+
+/// Sets the brightness of all leds selected by `led_mask`.
+///
+/// @param led_mask Selection of leds (#LED_BANK_MASK_SIZE bytes).
+/// @param brightness The brightness to set the leds to (4bit).
+void led_bank_brightness_set_mask(const uint8_t* led_mask, uint8_t brightness);
+
+/// Sets the color(s) and brightness of all leds selected by `led_mask` in a
+/// single pass.
+///
+/// @param led_mask Selection of leds (#LED_BANK_MASK_SIZE bytes).
+/// @param color The color(s) to set the leds to (3bit).
+/// @param brightness The brightness to set the leds to (4bit).
+void led_bank_settings_set_mask(const uint8_t* led_mask, uint8_t color, uint8_t brightness);
+
+#endif
@@ -0,0 +1,323 @@
+//! \file led_effect.c
+//! Implementation for the led effects.
+//!
+//! See led_effect.h for the available functions and documentation.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "led.h"
+#include "led_effect.h"
+#include "registers.h"
+
+/// Fraction bits of the fixed point rates.
+#define LED_EFFECT_RATE_SHIFT 16
+
+/// Output value of an effect which was not written yet.
+#define LED_EFFECT_NO_OUTPUT 0xff
+
+/// Kinds of effects.
+typedef enum {
+	LED_EFFECT_NONE = 0,
+	LED_EFFECT_FADE,
+	LED_EFFECT_BLINK,
+	LED_EFFECT_PULSE,
+} LedEffectKind;
+
+/// State of a single running effect.
+typedef struct {
+	/// Kind of the effect (#LedEffectKind).
+	uint8_t kind;
+	/// Output of the last tick (#LED_EFFECT_NO_OUTPUT if none).
+	uint8_t output;
+	/// Fade: brightness at the start of the fade.
+	uint8_t from;
+	/// Fade: target brightness.
+	uint8_t to;
+	/// Time the effect (fade) or the current period (blink, pulse) started.
+	uint32_t start;
+	/// Fade: duration, blink/pulse: period (ticks).
+	uint16_t duration;
+	/// Fade: brightness steps per tick, pulse: table steps per tick
+	/// (fixed point, #LED_EFFECT_RATE_SHIFT fraction bits).
+	uint32_t rate;
+} LedEffect;
+
+/// State of all effects.
+typedef struct {
+	/// Time of the last led_tick().
+	uint32_t now;
+	/// Fade or pulse.
+	LedEffect brightness;
+	/// Blink.
+	LedEffect state;
+} LedEffects;
+
+LedEffects led_effects;
+
+/// Brightness of each step of a pulse period (triangle, no floating point at runtime).
+const uint8_t led_effect_pulse_table[LED_EFFECT_PULSE_STEPS] = {
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+	15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0,
+};
+
+/// Computes the rate of a fade.
+///
+/// @param from The brightness at the start of the fade.
+/// @param to The target brightness.
+/// @param duration The duration of the fade in ticks.
+///
+/// @return Brightness steps per tick (fixed point).
+uint32_t led_effect_fade_rate(uint8_t from, uint8_t to, uint16_t duration) {
+	uint32_t steps = from < to ? to - from : from - to;
+
+	return duration > 0 ? (steps << LED_EFFECT_RATE_SHIFT) / duration : 0;
+}
+
+/// Computes the rate of a pulse.
+///
+/// @param period The period of the pulse in ticks (at least `2`).
+///
+/// @return Table steps per tick (fixed point).
+uint32_t led_effect_pulse_rate(uint16_t period) {
+	return ((uint32_t)LED_EFFECT_PULSE_STEPS << LED_EFFECT_RATE_SHIFT) / period;
+}
+
+void led_effect_fade(uint8_t brightness, uint16_t duration) {
+	uint8_t from = (led_value() & LED_BRIGHTNESS_MASK) >> LED_BRIGHTNESS_OFFSET;
+	uint8_t to   = brightness & LED_BRIGHTNESS_VALUE_MASK;
+
+	led_effects.brightness = (LedEffect){
+		.kind     = LED_EFFECT_FADE,
+		.output   = LED_EFFECT_NO_OUTPUT,
+		.from     = from,
+		.to       = to,
+		.start    = led_effects.now,
+		.duration = duration,
+		.rate     = led_effect_fade_rate(from, to, duration),
+	};
+}
+
+bool led_effect_blink(uint16_t period) {
+	if (period < 2) {
+		return false;
+	}
+
+	led_effects.state = (LedEffect){
+		.kind     = LED_EFFECT_BLINK,
+		.output   = LED_EFFECT_NO_OUTPUT,
+		.start    = led_effects.now,
+		.duration = period,
+	};
+
+	return true;
+}
+
+bool led_effect_pulse(uint16_t period) {
+	if (period < 2) {
+		return false;
+	}
+
+	led_effects.brightness = (LedEffect){
+		.kind     = LED_EFFECT_PULSE,
+		.output   = LED_EFFECT_NO_OUTPUT,
+		.start    = led_effects.now,
+		.duration = period,
+		.rate     = led_effect_pulse_rate(period),
+	};
+
+	return true;
+}
+
+void led_effect_stop(void) {
+	led_effects.brightness.kind = LED_EFFECT_NONE;
+	led_effects.state.kind = LED_EFFECT_NONE;
+}
+
+bool led_effect_active(void) {
+	return led_effects.brightness.kind != LED_EFFECT_NONE || led_effects.state.kind != LED_EFFECT_NONE;
+}
+
+/*
+ * Save / restore
+ */
+
+/// Number of bytes of a single saved effect.
+#define LED_EFFECT_SAVED_SIZE 10
+
+_Static_assert(2 * LED_EFFECT_SAVED_SIZE == LED_EFFECT_SAVE_SIZE, "LED_EFFECT_SAVE_SIZE must hold both effects");
+
+/// Saves a single effect.
+///
+/// Layout: kind, output, from, to (`1` byte each), ticks since the start
+/// (`4` bytes, little endian), duration (`2` bytes, little endian). The rate
+/// is recalculated on restore.
+///
+/// @param effect The effect.
+/// @param buffer Receives the effect (#LED_EFFECT_SAVED_SIZE bytes).
+void led_effect_save_one(const LedEffect* effect, uint8_t* buffer) {
+	uint32_t elapsed = led_effects.now - effect->start;
+
+	buffer[0] = effect->kind;
+	buffer[1] = effect->output;
+	buffer[2] = effect->from;
+	buffer[3] = effect->to;
+	buffer[4] = elapsed & 0xff;
+	buffer[5] = (elapsed >> 8) & 0xff;
+	buffer[6] = (elapsed >> 16) & 0xff;
+	buffer[7] = (elapsed >> 24) & 0xff;
+	buffer[8] = effect->duration & 0xff;
+	buffer[9] = effect->duration >> 8;
+}
+
+/// Loads a single effect saved by led_effect_save_one().
+///
+/// @param buffer The saved effect.
+/// @param effect Receives the effect.
+///
+/// @return `true` if the effect is valid, `false` otherwise.
+bool led_effect_load_one(const uint8_t* buffer, LedEffect* effect) {
+	uint32_t elapsed = buffer[4] | buffer[5] << 8 | buffer[6] << 16 | (uint32_t)buffer[7] << 24;
+
+	*effect = (LedEffect){
+		.kind     = buffer[0],
+		.output   = buffer[1],
+		.from     = buffer[2],
+		.to       = buffer[3],
+		.start    = led_effects.now - elapsed,
+		.duration = buffer[8] | buffer[9] << 8,
+	};
+
+	switch (effect->kind) {
+		case LED_EFFECT_NONE:
+			return true;
+		case LED_EFFECT_FADE:
+			if (effect->from > LED_BRIGHTNESS_MAX || effect->to > LED_BRIGHTNESS_MAX) {
+				return false;
+			}
+
+			effect->rate = led_effect_fade_rate(effect->from, effect->to, effect->duration);
+			return true;
+		case LED_EFFECT_BLINK:
+			return effect->duration >= 2;
+		case LED_EFFECT_PULSE:
+			if (effect->duration < 2) {
+				return false;
+			}
+
+			effect->rate = led_effect_pulse_rate(effect->duration);
+			return true;
+		default:
+			return false;
+	}
+}
+
+void led_effect_save(uint8_t* buffer) {
+	led_effect_save_one(&led_effects.brightness, buffer);
+	led_effect_save_one(&led_effects.state, &buffer[LED_EFFECT_SAVED_SIZE]);
+}
+
+bool led_effect_restore(const uint8_t* buffer) {
+	LedEffect brightness;
+	LedEffect state;
+
+	if (!led_effect_load_one(buffer, &brightness)
+			|| !led_effect_load_one(&buffer[LED_EFFECT_SAVED_SIZE], &state)
+			|| brightness.kind == LED_EFFECT_BLINK
+			|| (state.kind != LED_EFFECT_NONE && state.kind != LED_EFFECT_BLINK)) {
+		return false;
+	}
+
+	led_effects.brightness = brightness;
+	led_effects.state = state;
+
+	return true;
+}
+
+/// Returns the ticks since the start of the current period of a periodic
+/// effect and moves its start to the current period.
+///
+/// Keeps the elapsed time small, so it never wraps around.
+///
+/// @param effect The periodic effect.
+/// @param now The current time.
+///
+/// @return The ticks since the start of the current period (`< effect->duration`).
+uint32_t led_effect_period_elapsed(LedEffect* effect, uint32_t now) {
+	uint32_t elapsed = now - effect->start;
+
+	if (elapsed >= effect->duration) {
+		elapsed %= effect->duration;
+		effect->start = now - elapsed;
+	}
+
+	return elapsed;
+}
+
+/// Computes the brightness of the active brightness effect at `now`.
+///
+/// Ends the fade once it reached its target.
+///
+/// @param effect The brightness effect.
+/// @param now The current time.
+///
+/// @return The brightness (4bit).
+uint8_t led_effect_brightness_at(LedEffect* effect, uint32_t now) {
+	if (effect->kind == LED_EFFECT_PULSE) {
+		uint32_t elapsed = led_effect_period_elapsed(effect, now);
+
+		return led_effect_pulse_table[(elapsed * effect->rate) >> LED_EFFECT_RATE_SHIFT];
+	}
+
+	uint32_t elapsed = now - effect->start;
+
+	if (elapsed >= effect->duration) {
+		effect->kind = LED_EFFECT_NONE;
+		return effect->to;
+	}
+
+	// `elapsed < duration`, so the offset is always smaller than the distance.
+	uint8_t offset = (elapsed * effect->rate) >> LED_EFFECT_RATE_SHIFT;
+
+	return effect->from < effect->to ? effect->from + offset : effect->from - offset;
+}
+
+bool led_tick(uint32_t now) {
+	LedEffect* brightness = &led_effects.brightness;
+	LedEffect* state = &led_effects.state;
+	bool brightness_changed = false;
+	bool state_changed = false;
+
+	led_effects.now = now;
+
+	if (brightness->kind != LED_EFFECT_NONE) {
+		uint8_t output = led_effect_brightness_at(brightness, now);
+
+		brightness_changed = output != brightness->output;
+		brightness->output = output;
+	}
+
+	if (state->kind == LED_EFFECT_BLINK) {
+		uint32_t elapsed = led_effect_period_elapsed(state, now);
+		uint8_t output = elapsed < state->duration / 2u ? LED_STATE_ON : LED_STATE_OFF;
+
+		state_changed = output != state->output;
+		state->output = output;
+	}
+
+	if (!brightness_changed && !state_changed) {
+		return false;
+	}
+
+	led_begin();
+
+	if (brightness_changed) {
+		led_brightness_set(brightness->output);
+	}
+
+	if (state_changed) {
+		led_state_set(state->output);
+	}
+
+	return led_commit();
+}
@@ -0,0 +1,92 @@
+//! \file led_effect.h
+//!
+//! Time based effects (fade, blink, pulse) for the led.
+//!
+//! An effect is started once and then advanced by calling led_tick() with the
+//! current time. Time is measured in ticks of the caller (e.g. milliseconds);
+//! the unit only has to be the same for all calls. Effects start at the time
+//! passed to the last led_tick() call.
+//!
+//! A brightness effect (fade or pulse) and a state effect (blink) can be
+//! active at the same time. Starting a brightness effect replaces the active
+//! brightness effect.
+//!
+//! # NOTE
+//! led_tick() only uses integer math (precomputed fixed point rates and a
+//! step table) and only writes the led register if the output of the effects
+//! changed since the last tick.
+
+#ifndef _LED_EFFECT_H_
+#define _LED_EFFECT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Number of brightness steps of a single pulse period.
+#define LED_EFFECT_PULSE_STEPS 32
+
+/// Number of bytes of the state saved by led_effect_save().
+#define LED_EFFECT_SAVE_SIZE 20
+
+/// Starts fading the brightness from its current value to `brightness`.
+///
+/// The effect ends once the target brightness is reached.
+///
+/// @param brightness The target brightness (4bit).
+/// @param duration The duration of the fade in ticks (`0` sets the brightness on the next tick).
+void led_effect_fade(uint8_t brightness, uint16_t duration);
+
+/// Starts blinking the led (on for the first, off for the second half of
+/// each period).
+///
+/// @param period The period of the blinking in ticks.
+///
+/// @return `true` if the effect was started, `false` if `period` is smaller than `2`.
+bool led_effect_blink(uint16_t period);
+
+/// Starts pulsing the brightness (minimum to maximum and back each period).
+///
+/// @param period The period of the pulse in ticks.
+///
+/// @return `true` if the effect was started, `false` if `period` is smaller than `2`.
+bool led_effect_pulse(uint16_t period);
+
+/// Stops all effects.
+///
+/// The led keeps the output of the last tick.
+void led_effect_stop(void);
+
+/// Returns if any effect is active.
+///
+/// @return `true` if an effect is active, `false` otherwise.
+bool led_effect_active(void);
+
+/// Saves the state of all effects (e.g. for a snapshot, see led_snapshot.h).
+///
+/// Times are saved relative to the last led_tick(), so the effects continue
+/// where they left off once restored, even if the ticks restart.
+///
+/// @param buffer Receives the state (#LED_EFFECT_SAVE_SIZE bytes).
+void led_effect_save(uint8_t* buffer);
+
+/// Restores the state of all effects saved by led_effect_save().
+///
+/// The effects continue relative to the last led_tick() (or `0` if none was
+/// called yet).
+///
+/// @param buffer The saved state (#LED_EFFECT_SAVE_SIZE bytes).
+///
+/// @return `true` if the state was restored, `false` if it is invalid (the effects are not changed).
+bool led_effect_restore(const uint8_t* buffer);
+
+/// Advances all active effects to `now`.
+///
+/// All changes are applied in a single led transaction (see led_begin()). The
+/// led register is not touched if the output did not change.
+///
+/// @param now The current time in ticks (may wrap around).
+///
+/// @return `true` if the led register was written, `false` otherwise.
+bool led_tick(uint32_t now);
+
+#endif
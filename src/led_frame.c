@@ -0,0 +1,78 @@
+//! \file led_frame.c
+//! Implementation for the double buffered frames.
+//!
+//! See led_frame.h for the available functions and documentation.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "led_bank.h"
+#include "led_frame.h"
+#include "registers.h"
+
+/// Storage of both frames.
+uint8_t led_frames[2][LED_BANK_SIZE];
+
+/// Index of the front frame.
+atomic_uint led_frame_front;
+
+/// Number of readers of each frame.
+atomic_uint led_frame_readers[2];
+
+void led_frame_init(void) {
+	memcpy(led_frames[0], LED_BANK, LED_BANK_SIZE);
+	memcpy(led_frames[1], LED_BANK, LED_BANK_SIZE);
+	atomic_store(&led_frame_front, 0);
+}
+
+bool led_frame_begin(void) {
+	unsigned front = atomic_load_explicit(&led_frame_front, memory_order_relaxed);
+	unsigned back = front ^ 1;
+
+	// Pairs with the re-check in led_frame_acquire() (both sequentially
+	// consistent): a reader either sees the new front or is seen here.
+	if (atomic_load(&led_frame_readers[back]) != 0) {
+		return false;
+	}
+
+	memcpy(led_frames[back], LED_BANK, LED_BANK_SIZE);
+	led_bank_target(led_frames[back]);
+
+	return true;
+}
+
+void led_frame_swap(void) {
+	unsigned back = atomic_load_explicit(&led_frame_front, memory_order_relaxed) ^ 1;
+
+	// Publishes all writes to the back frame.
+	atomic_store(&led_frame_front, back);
+	led_bank_target(NULL);
+
+	registers_write_begin();
+	memcpy(LED_BANK, led_frames[back], LED_BANK_SIZE);
+	registers_write_end();
+}
+
+const uint8_t* led_frame_acquire(void) {
+	for (;;) {
+		unsigned front = atomic_load(&led_frame_front);
+
+		atomic_fetch_add(&led_frame_readers[front], 1);
+
+		// The frame might have become the back frame in the meantime.
+		if (atomic_load(&led_frame_front) == front) {
+			return led_frames[front];
+		}
+
+		atomic_fetch_sub(&led_frame_readers[front], 1);
+	}
+}
+
+void led_frame_release(const uint8_t* frame) {
+	unsigned index = frame == led_frames[0] ? 0 : 1;
+
+	atomic_fetch_sub_explicit(&led_frame_readers[index], 1, memory_order_release);
+}
@@ -0,0 +1,76 @@
+//! \file led_frame.h
+//!
+//! Double buffered frames of the led bank.
+//!
+//! Two frames of #LED_BANK_SIZE registers are kept: the front frame is read
+//! by observers (e.g. the scan out / DMA), the back frame is composed by a
+//! writer with the regular `led_bank_*` functions. led_frame_swap() publishes
+//! the back frame by flipping a single index (release semantics), so readers
+//! always see complete frames. The published frame is also copied into
+//! #LED_BANK with a single registers write (see registers_write_begin()), so
+//! registers_snapshot(), readers of a shared region (see registers_shm.h) and
+//! led snapshots (see led_snapshot.h) see every published frame as a whole:
+//!
+//! ```c
+//! // Writer
+//! while (!led_frame_begin()) {
+//!     // The back frame is still read, try again later.
+//! }
+//!
+//! led_bank_settings_set_range(0, 128, LED_COLOR_RED, LED_BRIGHTNESS_MAX);
+//! led_bank_state_on(7);
+//! led_frame_swap();
+//!
+//! // Reader
+//! const uint8_t* frame = led_frame_acquire();
+//! scan_out(frame, LED_BANK_SIZE);
+//! led_frame_release(frame);
+//! ```
+//!
+//! # NOTE
+//! Only a single writer is supported. Any number of readers may acquire the
+//! front frame concurrently.
+
+#ifndef _LED_FRAME_H_
+#define _LED_FRAME_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "registers.h"
+
+/// Initializes both frames with a copy of #LED_BANK.
+///
+/// Must not be called while a frame is composed or acquired.
+void led_frame_init(void);
+
+/// Starts composing the next frame (writer).
+///
+/// The back frame is initialized with a copy of #LED_BANK (the last published
+/// frame, including later changes of #LED_BANK) and all `led_bank_*`
+/// functions of the calling thread are redirected to it until
+/// led_frame_swap().
+///
+/// @return `true` if composing started, `false` if a reader still holds the back frame (nothing changed).
+bool led_frame_begin(void);
+
+/// Publishes the composed frame as the new front frame (writer).
+///
+/// The frame is copied into #LED_BANK with a single registers write. The
+/// `led_bank_*` functions of the calling thread change #LED_BANK again
+/// afterwards.
+void led_frame_swap(void);
+
+/// Acquires the front frame for reading.
+///
+/// The frame stays unchanged until it is released with led_frame_release().
+///
+/// @return The registers of the front frame (#LED_BANK_SIZE bytes).
+const uint8_t* led_frame_acquire(void);
+
+/// Releases a frame acquired with led_frame_acquire().
+///
+/// @param frame The frame.
+void led_frame_release(const uint8_t* frame);
+
+#endif
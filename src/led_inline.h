@@ -0,0 +1,122 @@
+//! \file led_inline.h
+//!
+//! Header only variants of the led state/color/brightness setters.
+//!
+//! Included by led.h when `LED_INLINE` is defined. The setters become
+//! `static inline` functions with compile time constant masks, so a call like
+//! `led_color_red()` compiles down to a check of the transaction depth and a
+//! masked update of the led register (or of the shadow during a transaction,
+//! see led_begin()) instead of a chain of (PLT) calls into the library.
+//!
+//! The behavior is the same as the one of the library functions. If the
+//! including code is compiled with `LED_STATS` or `LED_TRACE`, the register
+//! writes go through the library (led_register_write()), so they are counted
+//! and recorded as well. All other functions of led.h (init, clear,
+//! transactions) are still provided by the library.
+//!
+//! # NOTE
+//! The including code must be compiled with the same `LED_STATS`/`LED_TRACE`
+//! defines as the library. Otherwise linking fails with an undefined
+//! reference to `led_library_instrumented` or `led_library_plain`, instead
+//! of silently skipping (or expecting) the instrumentation hooks.
+
+#ifndef _LED_INLINE_H_
+#define _LED_INLINE_H_
+
+#ifndef LED_INLINE
+#define LED_INLINE
+#endif
+
+#include <stdint.h>
+
+#include "led.h"
+#include "registers.h"
+
+// Transaction state of led.c (see led_begin()).
+extern uint8_t led_transaction_depth;
+extern uint8_t led_shadow;
+extern uint8_t led_shadow_mask;
+
+// Register write of led.c (see set_led_bits()).
+void led_register_write(uint8_t value, uint8_t mask);
+
+// Instrumentation of the library (see led.c). Referencing the symbol of the
+// instrumentation of the including code turns a mismatch into a link error.
+#if defined LED_STATS || defined LED_TRACE
+extern const uint8_t led_library_instrumented;
+__attribute__((used)) static const uint8_t* const led_inline_library_check = &led_library_instrumented;
+#else
+extern const uint8_t led_library_plain;
+__attribute__((used)) static const uint8_t* const led_inline_library_check = &led_library_plain;
+#endif
+
+/// Sets the bits masked by `mask` of the led register (or of the shadow during a transaction).
+static inline void led_inline_bits_set(uint8_t rhs, uint8_t mask) {
+	if (led_transaction_depth > 0) {
+		led_shadow       = (led_shadow & ~mask) | (rhs & mask);
+		led_shadow_mask |= mask;
+	} else {
+#if defined LED_STATS || defined LED_TRACE
+		led_register_write((LED & ~mask) | (rhs & mask), mask);
+#else
+		// Same as led_register_write() without the instrumentation hooks.
+		registers_write_begin();
+		LED = (LED & ~mask) | (rhs & mask);
+		registers_write_end();
+#endif
+	}
+}
+
+/*
+ * STATE
+ */
+
+static inline void led_state_set(LedState state) {
+	led_inline_bits_set((state & LED_STATE_VALUE_MASK) << LED_STATE_OFFSET, LED_STATE_MASK);
+}
+
+static inline void led_state_on(void) {
+	led_state_set(LED_STATE_ON);
+}
+
+static inline void led_state_off(void) {
+	led_state_set(LED_STATE_OFF);
+}
+
+/*
+ * COLOR
+ */
+
+static inline void led_color_set(uint8_t color) {
+	led_inline_bits_set((color & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET, LED_COLOR_MASK);
+}
+
+static inline void led_color_red(void) {
+	led_color_set(LED_COLOR_RED);
+}
+
+static inline void led_color_green(void) {
+	led_color_set(LED_COLOR_GREEN);
+}
+
+static inline void led_color_blue(void) {
+	led_color_set(LED_COLOR_BLUE);
+}
+
+/*
+ * BRIGHTNESS
+ */
+
+static inline void led_brightness_set(uint8_t brightness) {
+	led_inline_bits_set((brightness & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET, LED_BRIGHTNESS_MASK);
+}
+
+static inline void led_brightness_min(void) {
+	led_brightness_set(LED_BRIGHTNESS_MIN);
+}
+
+static inline void led_brightness_max(void) {
+	led_brightness_set(LED_BRIGHTNESS_MAX);
+}
+
+#endif
@@ -0,0 +1,227 @@
+//! \file led_pack.c
+//! Implementation for the bulk pack/unpack of led registers.
+//!
+//! See led_pack.h for the available functions and documentation.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "led.h"
+#include "led_pack.h"
+
+// The SIMD kernels are compiled with per function target attributes, so the
+// library itself does not require the instruction sets.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LED_PACK_X86
+#include <immintrin.h>
+#endif
+
+/// Packs a range of leds.
+typedef void (*LedPackKernel)(size_t count, const uint8_t* state, const uint8_t* color, const uint8_t* brightness, uint8_t* packed);
+/// Unpacks a range of leds.
+typedef void (*LedUnpackKernel)(size_t count, const uint8_t* packed, uint8_t* state, uint8_t* color, uint8_t* brightness);
+
+/*
+ * Scalar
+ */
+
+void led_pack_scalar(size_t count, const uint8_t* state, const uint8_t* color, const uint8_t* brightness, uint8_t* packed) {
+	for (size_t i = 0; i < count; i++) {
+		packed[i] = (state[i] & LED_STATE_VALUE_MASK) << LED_STATE_OFFSET
+			| (color[i] & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET
+			| (brightness[i] & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET;
+	}
+}
+
+void led_unpack_scalar(size_t count, const uint8_t* packed, uint8_t* state, uint8_t* color, uint8_t* brightness) {
+	for (size_t i = 0; i < count; i++) {
+		state[i]      = (packed[i] >> LED_STATE_OFFSET) & LED_STATE_VALUE_MASK;
+		color[i]      = (packed[i] >> LED_COLOR_OFFSET) & LED_COLOR_VALUE_MASK;
+		brightness[i] = (packed[i] >> LED_BRIGHTNESS_OFFSET) & LED_BRIGHTNESS_VALUE_MASK;
+	}
+}
+
+#ifdef LED_PACK_X86
+
+/*
+ * SSE2
+ *
+ * There are no 8bit shifts, so 16bit shifts are used. The values are masked
+ * before (pack) or after (unpack) the shift, so no bits cross into the
+ * neighbouring byte.
+ */
+
+__attribute__((target("sse2")))
+void led_pack_sse2(size_t count, const uint8_t* state, const uint8_t* color, const uint8_t* brightness, uint8_t* packed) {
+	const __m128i state_mask      = _mm_set1_epi8(LED_STATE_VALUE_MASK);
+	const __m128i color_mask      = _mm_set1_epi8(LED_COLOR_VALUE_MASK);
+	const __m128i brightness_mask = _mm_set1_epi8(LED_BRIGHTNESS_VALUE_MASK);
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i s = _mm_and_si128(_mm_loadu_si128((const __m128i*)&state[i]), state_mask);
+		__m128i c = _mm_and_si128(_mm_loadu_si128((const __m128i*)&color[i]), color_mask);
+		__m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)&brightness[i]), brightness_mask);
+
+		__m128i value = _mm_or_si128(_mm_slli_epi16(s, LED_STATE_OFFSET), _mm_or_si128(_mm_slli_epi16(c, LED_COLOR_OFFSET), _mm_slli_epi16(b, LED_BRIGHTNESS_OFFSET)));
+
+		_mm_storeu_si128((__m128i*)&packed[i], value);
+	}
+
+	led_pack_scalar(count - i, &state[i], &color[i], &brightness[i], &packed[i]);
+}
+
+__attribute__((target("sse2")))
+void led_unpack_sse2(size_t count, const uint8_t* packed, uint8_t* state, uint8_t* color, uint8_t* brightness) {
+	const __m128i state_mask      = _mm_set1_epi8(LED_STATE_VALUE_MASK);
+	const __m128i color_mask      = _mm_set1_epi8(LED_COLOR_VALUE_MASK);
+	const __m128i brightness_mask = _mm_set1_epi8(LED_BRIGHTNESS_VALUE_MASK);
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i value = _mm_loadu_si128((const __m128i*)&packed[i]);
+
+		_mm_storeu_si128((__m128i*)&state[i], _mm_and_si128(_mm_srli_epi16(value, LED_STATE_OFFSET), state_mask));
+		_mm_storeu_si128((__m128i*)&color[i], _mm_and_si128(_mm_srli_epi16(value, LED_COLOR_OFFSET), color_mask));
+		_mm_storeu_si128((__m128i*)&brightness[i], _mm_and_si128(_mm_srli_epi16(value, LED_BRIGHTNESS_OFFSET), brightness_mask));
+	}
+
+	led_unpack_scalar(count - i, &packed[i], &state[i], &color[i], &brightness[i]);
+}
+
+/*
+ * AVX2 (same as SSE2 with twice the width)
+ */
+
+__attribute__((target("avx2")))
+void led_pack_avx2(size_t count, const uint8_t* state, const uint8_t* color, const uint8_t* brightness, uint8_t* packed) {
+	const __m256i state_mask      = _mm256_set1_epi8(LED_STATE_VALUE_MASK);
+	const __m256i color_mask      = _mm256_set1_epi8(LED_COLOR_VALUE_MASK);
+	const __m256i brightness_mask = _mm256_set1_epi8(LED_BRIGHTNESS_VALUE_MASK);
+	size_t i = 0;
+
+	for (; i + 32 <= count; i += 32) {
+		__m256i s = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&state[i]), state_mask);
+		__m256i c = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&color[i]), color_mask);
+		__m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&brightness[i]), brightness_mask);
+
+		__m256i value = _mm256_or_si256(_mm256_slli_epi16(s, LED_STATE_OFFSET), _mm256_or_si256(_mm256_slli_epi16(c, LED_COLOR_OFFSET), _mm256_slli_epi16(b, LED_BRIGHTNESS_OFFSET)));
+
+		_mm256_storeu_si256((__m256i*)&packed[i], value);
+	}
+
+	led_pack_sse2(count - i, &state[i], &color[i], &brightness[i], &packed[i]);
+}
+
+__attribute__((target("avx2")))
+void led_unpack_avx2(size_t count, const uint8_t* packed, uint8_t* state, uint8_t* color, uint8_t* brightness) {
+	const __m256i state_mask      = _mm256_set1_epi8(LED_STATE_VALUE_MASK);
+	const __m256i color_mask      = _mm256_set1_epi8(LED_COLOR_VALUE_MASK);
+	const __m256i brightness_mask = _mm256_set1_epi8(LED_BRIGHTNESS_VALUE_MASK);
+	size_t i = 0;
+
+	for (; i + 32 <= count; i += 32) {
+		__m256i value = _mm256_loadu_si256((const __m256i*)&packed[i]);
+
+		_mm256_storeu_si256((__m256i*)&state[i], _mm256_and_si256(_mm256_srli_epi16(value, LED_STATE_OFFSET), state_mask));
+		_mm256_storeu_si256((__m256i*)&color[i], _mm256_and_si256(_mm256_srli_epi16(value, LED_COLOR_OFFSET), color_mask));
+		_mm256_storeu_si256((__m256i*)&brightness[i], _mm256_and_si256(_mm256_srli_epi16(value, LED_BRIGHTNESS_OFFSET), brightness_mask));
+	}
+
+	led_unpack_sse2(count - i, &packed[i], &state[i], &color[i], &brightness[i]);
+}
+
+#endif
+
+/*
+ * Dispatch
+ */
+
+/// Kernels and name of an implementation.
+typedef struct {
+	/// Name of the implementation.
+	const char* name;
+	/// The pack kernel (`NULL` if not part of the build).
+	LedPackKernel pack;
+	/// The unpack kernel (`NULL` if not part of the build).
+	LedUnpackKernel unpack;
+} LedPackKernels;
+
+/// All implementations, indexed by #LedPackImplementation.
+const LedPackKernels led_pack_kernels[LED_PACK_IMPLEMENTATIONS] = {
+	[LED_PACK_SCALAR] = { "scalar", led_pack_scalar, led_unpack_scalar },
+#ifdef LED_PACK_X86
+	[LED_PACK_SSE2]   = { "sse2", led_pack_sse2, led_unpack_sse2 },
+	[LED_PACK_AVX2]   = { "avx2", led_pack_avx2, led_unpack_avx2 },
+#else
+	[LED_PACK_SSE2]   = { "sse2", NULL, NULL },
+	[LED_PACK_AVX2]   = { "avx2", NULL, NULL },
+#endif
+};
+
+/// The selected implementation (`NULL` until the first call).
+const LedPackKernels* led_pack_active;
+
+bool led_pack_supported(LedPackImplementation implementation) {
+	if (implementation >= LED_PACK_IMPLEMENTATIONS || led_pack_kernels[implementation].pack == NULL) {
+		return false;
+	}
+
+#ifdef LED_PACK_X86
+	__builtin_cpu_init();
+
+	switch (implementation) {
+		case LED_PACK_SSE2:
+			return __builtin_cpu_supports("sse2");
+		case LED_PACK_AVX2:
+			return __builtin_cpu_supports("avx2");
+		default:
+			break;
+	}
+#endif
+
+	return true;
+}
+
+bool led_pack_select(LedPackImplementation implementation) {
+	if (!led_pack_supported(implementation)) {
+		return false;
+	}
+
+	led_pack_active = &led_pack_kernels[implementation];
+
+	return true;
+}
+
+LedPackImplementation led_pack_implementation(void) {
+	if (led_pack_active == NULL) {
+		// Best supported implementation.
+		LedPackImplementation implementation = LED_PACK_IMPLEMENTATIONS;
+
+		while (!led_pack_select(--implementation)) {
+		}
+	}
+
+	return (LedPackImplementation)(led_pack_active - led_pack_kernels);
+}
+
+const char* led_pack_implementation_name(LedPackImplementation implementation) {
+	return implementation < LED_PACK_IMPLEMENTATIONS ? led_pack_kernels[implementation].name : "unknown";
+}
+
+void led_pack(size_t count, const uint8_t* state, const uint8_t* color, const uint8_t* brightness, uint8_t* packed) {
+	if (led_pack_active == NULL) {
+		led_pack_implementation();
+	}
+
+	led_pack_active->pack(count, state, color, brightness, packed);
+}
+
+void led_unpack(size_t count, const uint8_t* packed, uint8_t* state, uint8_t* color, uint8_t* brightness) {
+	if (led_pack_active == NULL) {
+		led_pack_implementation();
+	}
+
+	led_pack_active->unpack(count, packed, state, color, brightness);
+}
@@ -0,0 +1,76 @@
+//! \file led_pack.h
+//!
+//! Bulk conversion between separate state/color/brightness arrays
+//! (structure of arrays) and packed led register bytes (see led.h for the
+//! layout), e.g. to fill the led bank from a frame each refresh.
+//!
+//! The conversion uses SIMD kernels (SSE2, AVX2) if the cpu supports them and
+//! falls back to a portable scalar loop otherwise. The best implementation is
+//! selected at runtime on the first call; led_pack_select() allows to force
+//! one (e.g. for tests and benchmarks).
+//!
+//! # NOTE
+//! Like the led setters, the input values are constrained to the valid bits
+//! of their section (state 1bit, color 3bit, brightness 4bit).
+
+#ifndef _LED_PACK_H_
+#define _LED_PACK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// The available implementations.
+typedef enum {
+	/// Portable byte by byte loop.
+	LED_PACK_SCALAR = 0,
+	/// 16 leds per step (x86 SSE2).
+	LED_PACK_SSE2,
+	/// 32 leds per step (x86 AVX2).
+	LED_PACK_AVX2,
+	/// Number of implementations.
+	LED_PACK_IMPLEMENTATIONS,
+} LedPackImplementation;
+
+/// Packs the sections of `count` leds into register bytes.
+///
+/// @param count The number of leds.
+/// @param state The states of the leds (`count` bytes, 1bit used).
+/// @param color The colors of the leds (`count` bytes, 3bit used).
+/// @param brightness The brightness of the leds (`count` bytes, 4bit used).
+/// @param packed Receives the register bytes (`count` bytes).
+void led_pack(size_t count, const uint8_t* state, const uint8_t* color, const uint8_t* brightness, uint8_t* packed);
+
+/// Unpacks `count` register bytes into the sections of the leds.
+///
+/// @param count The number of leds.
+/// @param packed The register bytes (`count` bytes).
+/// @param state Receives the states of the leds (`count` bytes).
+/// @param color Receives the colors of the leds (`count` bytes).
+/// @param brightness Receives the brightness of the leds (`count` bytes).
+void led_unpack(size_t count, const uint8_t* packed, uint8_t* state, uint8_t* color, uint8_t* brightness);
+
+/// Returns if an implementation is supported by the build and the cpu.
+///
+/// @param implementation The implementation.
+///
+/// @return `true` if the implementation can be used, `false` otherwise.
+bool led_pack_supported(LedPackImplementation implementation);
+
+/// Forces an implementation for all following calls.
+///
+/// @param implementation The implementation.
+///
+/// @return `true` if the implementation was selected, `false` if it is not supported.
+bool led_pack_select(LedPackImplementation implementation);
+
+/// Returns the implementation which is used (selects the best one if none
+/// was selected yet).
+LedPackImplementation led_pack_implementation(void);
+
+/// Returns the name of an implementation (e.g. `"avx2"`).
+///
+/// @param implementation The implementation.
+const char* led_pack_implementation_name(LedPackImplementation implementation);
+
+#endif
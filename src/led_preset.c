@@ -0,0 +1,118 @@
+//! \file led_preset.c
+//! Implementation for the led presets and scenes.
+//!
+//! See led_preset.h for the available functions and documentation.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "led.h"
+#include "led_bank.h"
+#include "led_preset.h"
+
+/// Snapshot of a group of leds.
+typedef struct {
+	/// The first led of the group.
+	LedHandle first;
+	/// The number of leds of the group (`0` if the scene is empty).
+	uint8_t count;
+	/// The registers of the leds.
+	uint8_t values[LED_PRESET_SCENE_SIZE];
+} LedPresetScene;
+
+_Static_assert(LED_PRESET_SCENE_SIZE <= UINT8_MAX, "LED_PRESET_SCENE_SIZE must fit into a byte");
+
+/// Values of the presets.
+uint8_t led_presets[LED_PRESET_SLOTS];
+
+/// Snapshots of the scenes.
+LedPresetScene led_preset_scenes[LED_PRESET_SCENES];
+
+bool led_preset_store(uint8_t slot, uint8_t value) {
+	if (slot >= LED_PRESET_SLOTS) {
+		return false;
+	}
+
+	led_presets[slot] = value;
+
+	return true;
+}
+
+bool led_preset_store_current(uint8_t slot) {
+	return led_preset_store(slot, led_value());
+}
+
+bool led_preset_recall(uint8_t slot) {
+	if (slot >= LED_PRESET_SLOTS) {
+		return false;
+	}
+
+	led_value_set(led_presets[slot]);
+
+	return true;
+}
+
+bool led_preset_scene_store(uint8_t scene, LedHandle first, size_t count) {
+	if (scene >= LED_PRESET_SCENES || count > LED_PRESET_SCENE_SIZE) {
+		return false;
+	}
+
+	LedPresetScene* snapshot = &led_preset_scenes[scene];
+
+	snapshot->first = first;
+	snapshot->count = led_bank_values_get(first, count, snapshot->values);
+
+	return true;
+}
+
+bool led_preset_scene_recall(uint8_t scene) {
+	if (scene >= LED_PRESET_SCENES) {
+		return false;
+	}
+
+	LedPresetScene* snapshot = &led_preset_scenes[scene];
+
+	led_bank_values_set(snapshot->first, snapshot->count, snapshot->values);
+
+	return true;
+}
+
+/// Number of bytes of a single saved scene.
+#define LED_PRESET_SCENE_SAVED_SIZE (3 + LED_PRESET_SCENE_SIZE)
+
+void led_preset_save(uint8_t* buffer) {
+	memcpy(buffer, led_presets, LED_PRESET_SLOTS);
+
+	for (size_t i = 0; i < LED_PRESET_SCENES; i++) {
+		const LedPresetScene* scene = &led_preset_scenes[i];
+		uint8_t* saved = &buffer[LED_PRESET_SLOTS + i * LED_PRESET_SCENE_SAVED_SIZE];
+
+		saved[0] = scene->first & 0xff;
+		saved[1] = scene->first >> 8;
+		saved[2] = scene->count;
+		memcpy(&saved[3], scene->values, LED_PRESET_SCENE_SIZE);
+	}
+}
+
+bool led_preset_restore(const uint8_t* buffer) {
+	for (size_t i = 0; i < LED_PRESET_SCENES; i++) {
+		if (buffer[LED_PRESET_SLOTS + i * LED_PRESET_SCENE_SAVED_SIZE + 2] > LED_PRESET_SCENE_SIZE) {
+			return false;
+		}
+	}
+
+	memcpy(led_presets, buffer, LED_PRESET_SLOTS);
+
+	for (size_t i = 0; i < LED_PRESET_SCENES; i++) {
+		LedPresetScene* scene = &led_preset_scenes[i];
+		const uint8_t* saved = &buffer[LED_PRESET_SLOTS + i * LED_PRESET_SCENE_SAVED_SIZE];
+
+		scene->first = saved[0] | saved[1] << 8;
+		scene->count = saved[2];
+		memcpy(scene->values, &saved[3], LED_PRESET_SCENE_SIZE);
+	}
+
+	return true;
+}
@@ -0,0 +1,89 @@
+//! \file led_preset.h
+//!
+//! Cache of frequently used led states.
+//!
+//! A preset holds a complete value of the led register (state, color and
+//! brightness) which can be applied again with a single register write.
+//! A scene holds a snapshot of a group of consecutive leds of the led bank
+//! which can be applied again with a single bulk copy.
+//!
+//! # NOTE
+//! Presets are initially `0x00` (off), scenes are initially empty.
+
+#ifndef _LED_PRESET_H_
+#define _LED_PRESET_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "led_bank.h"
+
+/// Number of presets.
+#define LED_PRESET_SLOTS 16
+
+/// Number of scenes.
+#define LED_PRESET_SCENES 4
+
+/// Maximum number of leds of a single scene.
+#define LED_PRESET_SCENE_SIZE 64
+
+/// Number of bytes of the state saved by led_preset_save().
+#define LED_PRESET_SAVE_SIZE (LED_PRESET_SLOTS + LED_PRESET_SCENES * (3 + LED_PRESET_SCENE_SIZE))
+
+/// Stores a value of the led register in a preset.
+///
+/// @param slot The preset to store the value in.
+/// @param value The value of the led register.
+///
+/// @return `true` if the value was stored, `false` if `slot` is invalid.
+bool led_preset_store(uint8_t slot, uint8_t value);
+
+/// Stores the current value of the led register in a preset.
+///
+/// @param slot The preset to store the value in.
+///
+/// @return `true` if the value was stored, `false` if `slot` is invalid.
+bool led_preset_store_current(uint8_t slot);
+
+/// Applies a preset to the led with a single register write.
+///
+/// @param slot The preset to apply.
+///
+/// @return `true` if the preset was applied, `false` if `slot` is invalid.
+bool led_preset_recall(uint8_t slot);
+
+/// Stores a snapshot of `count` consecutive leds of the bank starting at
+/// `first` in a scene.
+///
+/// @param scene The scene to store the snapshot in.
+/// @param first The first led of the group.
+/// @param count The number of leds of the group (at most #LED_PRESET_SCENE_SIZE).
+///
+/// @return `true` if the snapshot was stored, `false` if `scene` or `count` is invalid.
+bool led_preset_scene_store(uint8_t scene, LedHandle first, size_t count);
+
+/// Applies a scene to its group of leds with a single bulk copy.
+///
+/// @param scene The scene to apply.
+///
+/// @return `true` if the scene was applied, `false` if `scene` is invalid.
+bool led_preset_scene_recall(uint8_t scene);
+
+/// Saves all presets and scenes (e.g. for a snapshot, see led_snapshot.h).
+///
+/// Layout: the presets (`1` byte each), then per scene the first led (`2`
+/// bytes, little endian), the number of leds (`1` byte) and the registers
+/// (#LED_PRESET_SCENE_SIZE bytes).
+///
+/// @param buffer Receives the state (#LED_PRESET_SAVE_SIZE bytes).
+void led_preset_save(uint8_t* buffer);
+
+/// Restores all presets and scenes saved by led_preset_save().
+///
+/// @param buffer The saved state (#LED_PRESET_SAVE_SIZE bytes).
+///
+/// @return `true` if the state was restored, `false` if it is invalid (the presets and scenes are not changed).
+bool led_preset_restore(const uint8_t* buffer);
+
+#endif
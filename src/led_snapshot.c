@@ -0,0 +1,203 @@
+//! \file led_snapshot.c
+//! Implementation for the persistent led snapshots.
+//!
+//! See led_snapshot.h for the available functions and documentation.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "led.h"
+#include "led_bank.h"
+#include "led_effect.h"
+#include "led_preset.h"
+#include "led_snapshot.h"
+#include "registers.h"
+
+/// Maximum length of the path of a snapshot (including the temporary suffix).
+#define LED_SNAPSHOT_PATH_MAX 4096
+
+/// Offset of the led bank in the payload.
+#define LED_SNAPSHOT_BANK_OFFSET    1
+/// Offset of the presets in the payload.
+#define LED_SNAPSHOT_PRESETS_OFFSET (LED_SNAPSHOT_BANK_OFFSET + LED_BANK_SIZE)
+/// Offset of the effects in the payload.
+#define LED_SNAPSHOT_EFFECTS_OFFSET (LED_SNAPSHOT_PRESETS_OFFSET + LED_PRESET_SAVE_SIZE)
+
+_Static_assert(LED_SNAPSHOT_EFFECTS_OFFSET + LED_EFFECT_SAVE_SIZE == LED_SNAPSHOT_PAYLOAD_SIZE, "The payload sections must fill the payload");
+
+/// Lookup table of the CRC-32 (one entry per byte value).
+uint32_t led_snapshot_crc_table[256];
+
+/// `true` once led_snapshot_crc_table is filled.
+bool led_snapshot_crc_ready;
+
+/// Writes a 32bit value (little endian).
+void led_snapshot_put32(uint8_t* buffer, uint32_t value) {
+	buffer[0] = value & 0xff;
+	buffer[1] = (value >> 8) & 0xff;
+	buffer[2] = (value >> 16) & 0xff;
+	buffer[3] = (value >> 24) & 0xff;
+}
+
+/// Reads a 32bit value (little endian).
+uint32_t led_snapshot_get32(const uint8_t* buffer) {
+	return buffer[0] | buffer[1] << 8 | buffer[2] << 16 | (uint32_t)buffer[3] << 24;
+}
+
+uint32_t led_snapshot_crc32(size_t bufferLength, const uint8_t* buffer) {
+	if (!led_snapshot_crc_ready) {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc = i;
+
+			for (int bit = 0; bit < 8; bit++) {
+				crc = crc & 0x1 ? (crc >> 1) ^ 0xedb88320u : crc >> 1;
+			}
+
+			led_snapshot_crc_table[i] = crc;
+		}
+
+		led_snapshot_crc_ready = true;
+	}
+
+	uint32_t crc = 0xffffffffu;
+
+	for (size_t i = 0; i < bufferLength; i++) {
+		crc = (crc >> 8) ^ led_snapshot_crc_table[(crc ^ buffer[i]) & 0xff];
+	}
+
+	return ~crc;
+}
+
+bool led_snapshot_encode(uint8_t* buffer) {
+	static RegistersSnapshot registers;
+
+	if (!registers_snapshot(registers_active, &registers)) {
+		return false;
+	}
+
+	uint8_t* payload = &buffer[LED_SNAPSHOT_HEADER_SIZE];
+
+	payload[0] = registers.led;
+	memcpy(&payload[LED_SNAPSHOT_BANK_OFFSET], registers.bank, LED_BANK_SIZE);
+	led_preset_save(&payload[LED_SNAPSHOT_PRESETS_OFFSET]);
+	led_effect_save(&payload[LED_SNAPSHOT_EFFECTS_OFFSET]);
+
+	led_snapshot_put32(&buffer[0], LED_SNAPSHOT_MAGIC);
+	buffer[4] = LED_SNAPSHOT_VERSION;
+	buffer[5] = LED_STATE_OFFSET;
+	buffer[6] = LED_COLOR_OFFSET;
+	buffer[7] = LED_BRIGHTNESS_OFFSET;
+	led_snapshot_put32(&buffer[8], LED_BANK_SIZE);
+	led_snapshot_put32(&buffer[12], LED_SNAPSHOT_PAYLOAD_SIZE);
+	led_snapshot_put32(&buffer[16], led_snapshot_crc32(LED_SNAPSHOT_PAYLOAD_SIZE, payload));
+
+	return true;
+}
+
+bool led_snapshot_decode(size_t bufferLength, const uint8_t* buffer) {
+	const uint8_t* payload = &buffer[LED_SNAPSHOT_HEADER_SIZE];
+
+	if (bufferLength != LED_SNAPSHOT_SIZE
+			|| led_snapshot_get32(&buffer[0]) != LED_SNAPSHOT_MAGIC
+			|| buffer[4] != LED_SNAPSHOT_VERSION
+			|| buffer[5] != LED_STATE_OFFSET
+			|| buffer[6] != LED_COLOR_OFFSET
+			|| buffer[7] != LED_BRIGHTNESS_OFFSET
+			|| led_snapshot_get32(&buffer[8]) != LED_BANK_SIZE
+			|| led_snapshot_get32(&buffer[12]) != LED_SNAPSHOT_PAYLOAD_SIZE
+			|| led_snapshot_get32(&buffer[16]) != led_snapshot_crc32(LED_SNAPSHOT_PAYLOAD_SIZE, payload)) {
+		return false;
+	}
+
+	// Keep the current effects, so nothing is changed if the presets are invalid.
+	uint8_t effects[LED_EFFECT_SAVE_SIZE];
+	led_effect_save(effects);
+
+	if (!led_effect_restore(&payload[LED_SNAPSHOT_EFFECTS_OFFSET])) {
+		return false;
+	}
+
+	if (!led_preset_restore(&payload[LED_SNAPSHOT_PRESETS_OFFSET])) {
+		led_effect_restore(effects);
+		return false;
+	}
+
+	led_value_set(payload[0]);
+	led_bank_values_set(0, LED_BANK_SIZE, &payload[LED_SNAPSHOT_BANK_OFFSET]);
+
+	return true;
+}
+
+bool led_snapshot_save(const char* path) {
+	static uint8_t buffer[LED_SNAPSHOT_SIZE];
+	char temporary[LED_SNAPSHOT_PATH_MAX];
+	int length = snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+
+	if (length < 0 || (size_t)length >= sizeof(temporary) || !led_snapshot_encode(buffer)) {
+		return false;
+	}
+
+	int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	size_t written = 0;
+
+	while (written < LED_SNAPSHOT_SIZE) {
+		ssize_t count = write(fd, &buffer[written], LED_SNAPSHOT_SIZE - written);
+
+		if (count <= 0) {
+			break;
+		}
+
+		written += (size_t)count;
+	}
+
+	// The snapshot must be on disk before it replaces the previous one.
+	bool complete = written == LED_SNAPSHOT_SIZE && fsync(fd) == 0;
+
+	if (close(fd) != 0 || !complete || rename(temporary, path) != 0) {
+		unlink(temporary);
+		return false;
+	}
+
+	return true;
+}
+
+bool led_snapshot_load(const char* path) {
+	bool restored = false;
+	int fd = open(path, O_RDONLY);
+
+	if (fd >= 0) {
+		struct stat st;
+
+		if (fstat(fd, &st) == 0 && (size_t)st.st_size == LED_SNAPSHOT_SIZE) {
+			void* data = mmap(NULL, LED_SNAPSHOT_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (data != MAP_FAILED) {
+				restored = led_snapshot_decode(LED_SNAPSHOT_SIZE, data);
+				munmap(data, LED_SNAPSHOT_SIZE);
+			}
+		}
+
+		close(fd);
+	}
+
+	if (!restored) {
+		led_init();
+		led_bank_init();
+	}
+
+	return restored;
+}
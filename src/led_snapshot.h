@@ -0,0 +1,115 @@
+//! \file led_snapshot.h
+//!
+//! Persistent snapshots of the led state for a warm start.
+//!
+//! A snapshot holds the led register, the led bank, the presets and scenes
+//! (see led_preset.h) and the running effects (see led_effect.h). It is
+//! written periodically and restored during startup instead of clearing the
+//! leds, so they keep their state across a restart:
+//!
+//! ```c
+//! // During startup (instead of led_init() / led_bank_init())
+//! led_snapshot_load("/var/lib/led/snapshot");
+//!
+//! // Periodically (e.g. every few seconds from the main loop)
+//! led_snapshot_save("/var/lib/led/snapshot");
+//! ```
+//!
+//! # Format
+//!
+//! All values are little endian.
+//!
+//! | Offset | Size | Description                                             |
+//! | ------ | ---- | ------------------------------------------------------- |
+//! | `0`    | `4`  | Magic `LSNP`                                            |
+//! | `4`    | `1`  | Version (#LED_SNAPSHOT_VERSION)                         |
+//! | `5`    | `1`  | Offset of the state section of the register layout      |
+//! | `6`    | `1`  | Offset of the color section of the register layout      |
+//! | `7`    | `1`  | Offset of the brightness section of the register layout |
+//! | `8`    | `4`  | Number of leds of the led bank (#LED_BANK_SIZE)         |
+//! | `12`   | `4`  | Length of the payload                                   |
+//! | `16`   | `4`  | CRC-32 (IEEE 802.3) of the payload                      |
+//! | `20`   |      | Payload                                                 |
+//!
+//! Payload: led register (`1` byte), led bank (`1` byte per led), presets
+//! (#LED_PRESET_SAVE_SIZE bytes, see led_preset_save()) and effects
+//! (#LED_EFFECT_SAVE_SIZE bytes, see led_effect_save()).
+//!
+//! A snapshot is only restored if all header fields match this build (a
+//! different board or bank size is treated like a corrupt snapshot).
+//!
+//! # NOTE
+//! The led register and the led bank are read with registers_snapshot(), so
+//! a snapshot can be taken while another thread writes the led bank.
+//! Snapshots are written to a temporary file which replaces the previous
+//! snapshot once it is complete, a crash while writing keeps the previous
+//! snapshot.
+
+#ifndef _LED_SNAPSHOT_H_
+#define _LED_SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "led_effect.h"
+#include "led_preset.h"
+#include "registers.h"
+
+/// Magic of a snapshot (`LSNP`, little endian).
+#define LED_SNAPSHOT_MAGIC 0x504e534cu
+
+/// Version of the snapshot format.
+#define LED_SNAPSHOT_VERSION 1
+
+/// Number of bytes of the header of a snapshot.
+#define LED_SNAPSHOT_HEADER_SIZE 20
+
+/// Number of bytes of the payload of a snapshot.
+#define LED_SNAPSHOT_PAYLOAD_SIZE (1 + LED_BANK_SIZE + LED_PRESET_SAVE_SIZE + LED_EFFECT_SAVE_SIZE)
+
+/// Number of bytes of a snapshot.
+#define LED_SNAPSHOT_SIZE (LED_SNAPSHOT_HEADER_SIZE + LED_SNAPSHOT_PAYLOAD_SIZE)
+
+/// Writes a snapshot of the current state into a buffer.
+///
+/// @param buffer Receives the snapshot (#LED_SNAPSHOT_SIZE bytes).
+///
+/// @return `true` on success, `false` if no consistent copy of the registers could be taken (see registers_snapshot()).
+bool led_snapshot_encode(uint8_t* buffer);
+
+/// Restores the state from a snapshot.
+///
+/// @param bufferLength The length of buffer.
+/// @param buffer The snapshot.
+///
+/// @return `true` if the state was restored, `false` if the snapshot is invalid (nothing is changed).
+bool led_snapshot_decode(size_t bufferLength, const uint8_t* buffer);
+
+/// Writes a snapshot of the current state to a file.
+///
+/// @param path The path of the snapshot.
+///
+/// @return `true` if the snapshot was written, `false` otherwise (the previous snapshot is kept).
+bool led_snapshot_save(const char* path);
+
+/// Initializes the led and the led bank from a snapshot file.
+///
+/// The file is memory mapped and restored directly from the mapping (see
+/// led_snapshot_decode()). If the file is missing or the snapshot is invalid
+/// the led and the led bank are cleared (see led_init() and led_bank_init()).
+///
+/// @param path The path of the snapshot.
+///
+/// @return `true` if the state was restored, `false` if the leds where cleared.
+bool led_snapshot_load(const char* path);
+
+/// Calculates the CRC-32 (IEEE 802.3) of a buffer.
+///
+/// @param bufferLength The length of buffer.
+/// @param buffer The data.
+///
+/// @return The checksum.
+uint32_t led_snapshot_crc32(size_t bufferLength, const uint8_t* buffer);
+
+#endif
@@ -0,0 +1,234 @@
+//! \file loadgen.c
+//!
+//! Load generator for the socket server (see server.c, which must run with
+//! replies enabled: `./server -r <socket>`).
+//!
+//! Every client is a thread with its own connection. It sends its messages
+//! in batches and waits for the results of a batch before it sends the next
+//! one. The throughput (messages per second over all clients) and the
+//! round trip latency of the batches (median and 99th percentile) are
+//! reported, the results are verified against the generated messages.
+//!
+//! ```sh
+//! ./loadgen <socket> [clients] [messages] [batch]
+//! ```
+//!
+//! `messages` is the number of messages per client (default `100000`),
+//! `batch` the number of messages per batch (default `64`, at most
+//! #LOADGEN_MAX_BATCH). The messages are mostly settings, some on/off and a
+//! few unknown op codes (#WORKLOAD_MIX_SERVER, see workload.h).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include "msg.h"
+#include "workload.h"
+
+/// Maximum number of messages per batch.
+#define LOADGEN_MAX_BATCH 4096
+
+/// State of a client thread.
+typedef struct {
+	/// Path of the server socket.
+	const char* path;
+	/// Number of messages to send.
+	size_t messages;
+	/// Number of messages per batch.
+	size_t batch;
+	/// Seed of the message generator.
+	uint32_t seed;
+	/// Round trip latency of each batch in nanoseconds.
+	double* latencies;
+	/// Number of entries in `latencies`.
+	size_t batches;
+	/// Number of results which did not match the generated messages.
+	size_t mismatches;
+	/// `true` if the client failed (connect, send or receive).
+	bool failed;
+} LoadgenClient;
+
+/// Comparison function for qsort() of doubles.
+int loadgen_compare_double(const void* lhs, const void* rhs) {
+	double a = *(const double*)lhs;
+	double b = *(const double*)rhs;
+
+	return (a > b) - (a < b);
+}
+
+/// Writes all bytes of a buffer.
+///
+/// @return `true` on success, `false` otherwise.
+bool loadgen_write_all(int fd, const uint8_t* buffer, size_t length) {
+	while (length > 0) {
+		ssize_t sent = write(fd, buffer, length);
+
+		if (sent <= 0) {
+			return false;
+		}
+
+		buffer += sent;
+		length -= (size_t)sent;
+	}
+
+	return true;
+}
+
+/// Reads exactly `length` bytes.
+///
+/// @return `true` on success, `false` otherwise.
+bool loadgen_read_all(int fd, uint8_t* buffer, size_t length) {
+	while (length > 0) {
+		ssize_t received = read(fd, buffer, length);
+
+		if (received <= 0) {
+			return false;
+		}
+
+		buffer += received;
+		length -= (size_t)received;
+	}
+
+	return true;
+}
+
+/// Client thread.
+///
+/// @param arg The #LoadgenClient of the thread.
+int loadgen_client(void* arg) {
+	LoadgenClient* client = arg;
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+	strncpy(address.sun_path, client->path, sizeof(address.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+		perror(client->path);
+		client->failed = true;
+
+		if (fd >= 0) {
+			close(fd);
+		}
+
+		return 1;
+	}
+
+	static _Thread_local uint8_t buffer[LOADGEN_MAX_BATCH * WORKLOAD_MAX_LENGTH];
+	static _Thread_local uint8_t expected[LOADGEN_MAX_BATCH];
+	static _Thread_local uint8_t results[LOADGEN_MAX_BATCH];
+	uint32_t state = client->seed;
+
+	for (size_t sent = 0; sent < client->messages; sent += client->batch) {
+		size_t count = client->messages - sent < client->batch ? client->messages - sent : client->batch;
+		size_t length = 0;
+
+		for (size_t i = 0; i < count; i++) {
+			length += workload_message(&state, WORKLOAD_MIX_SERVER, &buffer[length], &expected[i]);
+		}
+
+		uint64_t start = workload_now_ns();
+
+		if (!loadgen_write_all(fd, buffer, length) || !loadgen_read_all(fd, results, count)) {
+			fprintf(stderr, "Connection lost (is the server running with -r?)\n");
+			client->failed = true;
+			break;
+		}
+
+		client->latencies[client->batches++] = (double)(workload_now_ns() - start);
+
+		for (size_t i = 0; i < count; i++) {
+			client->mismatches += results[i] != expected[i];
+		}
+	}
+
+	close(fd);
+
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <socket> [clients] [messages] [batch]\n", argv[0]);
+		return 2;
+	}
+
+	size_t clients  = argc > 2 ? strtoul(argv[2], NULL, 10) : 8;
+	size_t messages = argc > 3 ? strtoul(argv[3], NULL, 10) : 100000;
+	size_t batch    = argc > 4 ? strtoul(argv[4], NULL, 10) : 64;
+
+	if (clients == 0 || messages == 0 || batch == 0 || batch > LOADGEN_MAX_BATCH) {
+		fprintf(stderr, "Invalid clients, messages or batch (1 - %d)\n", LOADGEN_MAX_BATCH);
+		return 2;
+	}
+
+	size_t batches = (messages + batch - 1) / batch;
+	LoadgenClient* states = calloc(clients, sizeof(LoadgenClient));
+	thrd_t* threads = calloc(clients, sizeof(thrd_t));
+	double* latencies = calloc(clients * batches, sizeof(double));
+
+	if (states == NULL || threads == NULL || latencies == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	uint64_t start = workload_now_ns();
+
+	for (size_t i = 0; i < clients; i++) {
+		states[i] = (LoadgenClient){ argv[1], messages, batch, 0x9e3779b9u ^ (uint32_t)(i + 1), &latencies[i * batches], 0, 0, false };
+
+		if (thrd_create(&threads[i], loadgen_client, &states[i]) != thrd_success) {
+			fprintf(stderr, "Failed to create thread %zu\n", i);
+			return 1;
+		}
+	}
+
+	size_t total = 0;
+	size_t mismatches = 0;
+	bool failed = false;
+
+	for (size_t i = 0; i < clients; i++) {
+		thrd_join(threads[i], NULL);
+
+		// Compact the latencies of all clients at the front.
+		memmove(&latencies[total], states[i].latencies, states[i].batches * sizeof(double));
+		total += states[i].batches;
+		mismatches += states[i].mismatches;
+		failed |= states[i].failed;
+	}
+
+	double seconds = (double)(workload_now_ns() - start) / 1e9;
+	size_t sent = 0;
+
+	for (size_t i = 0; i < clients; i++) {
+		sent += states[i].batches == batches ? messages : states[i].batches * batch;
+	}
+
+	qsort(latencies, total, sizeof(double), loadgen_compare_double);
+
+	printf("clients,messages,batch,seconds,msgs_per_s,batch_p50_us,batch_p99_us,mismatches\n");
+	printf("%zu,%zu,%zu,%.3f,%.0f,%.1f,%.1f,%zu\n",
+		clients,
+		sent,
+		batch,
+		seconds,
+		(double)sent / seconds,
+		total > 0 ? latencies[total / 2] / 1e3 : 0.0,
+		total > 0 ? latencies[total * 99 / 100] / 1e3 : 0.0,
+		mismatches);
+
+	free(latencies);
+	free(threads);
+	free(states);
+
+	return failed || mismatches > 0;
+}
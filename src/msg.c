@@ -3,20 +3,27 @@
 //!
 //! See msg.h for the available functions and documentation.
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "led.h"
+#include "led_effect.h"
+#include "led_preset.h"
 #include "msg.h"
+#include "msg_sched.h"
+#include "stats.h"
+#include "trace.h"
 
 /// Processes a `0x00` / `ON` op code message.
 ///
 /// @param len The total length of the received message.
+/// @param buffer The complete message
 ///
 /// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
-int process_op_on(uint8_t len) {
-	if (len != 1) {
-		return MSG_ERROR_CODE_TRAILING_BYTES;
-	}
+int process_op_on(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+	(void)buffer;
 
 	led_state_on();
 
@@ -26,12 +33,12 @@ int process_op_on(uint8_t len) {
 /// Processes a `0x01` / `OFF` op code message.
 ///
 /// @param len The total length of the received message.
+/// @param buffer The complete message
 ///
 /// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
-int process_op_off(uint8_t len) {
-	if (len != 1) {
-		return MSG_ERROR_CODE_TRAILING_BYTES;
-	}
+int process_op_off(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+	(void)buffer;
 
 	led_state_off();
 
@@ -44,15 +51,11 @@ int process_op_off(uint8_t len) {
 /// @param buffer The complete message
 ///
 /// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
-int process_op_led_settings(uint8_t len, uint8_t* buffer) {
-	if (len < 3) {
-		return MSG_ERROR_CODE_MISSING_PARAMETERS;
-	} else if (len > 3) {
-		return MSG_ERROR_CODE_TRAILING_BYTES;
-	}
+int process_op_led_settings(uint8_t len, const uint8_t* buffer) {
+	(void)len;
 
-	uint8_t color = buffer[1] & 0x7;
-	uint8_t brightness = buffer[2] & 0xf;
+	uint8_t color = buffer[1];
+	uint8_t brightness = buffer[2];
 
 	led_color_set(color);
 	led_brightness_set(brightness);
@@ -60,21 +63,626 @@ int process_op_led_settings(uint8_t len, uint8_t* buffer) {
 	return 0;
 }
 
-int process_message(uint8_t bufferLength, uint8_t* buffer) {
+/// Register bits of a `0x00` / `ON` op code message (see #MsgOpBits).
+uint8_t bits_op_on(const uint8_t* buffer, uint8_t* value) {
+	(void)buffer;
+
+	*value = LED_STATE_ON << LED_STATE_OFFSET;
+
+	return LED_STATE_MASK;
+}
+
+/// Register bits of a `0x01` / `OFF` op code message (see #MsgOpBits).
+uint8_t bits_op_off(const uint8_t* buffer, uint8_t* value) {
+	(void)buffer;
+
+	*value = LED_STATE_OFF << LED_STATE_OFFSET;
+
+	return LED_STATE_MASK;
+}
+
+/// Register bits of a `0x02` / `Led Settings` op code message (see #MsgOpBits).
+uint8_t bits_op_led_settings(const uint8_t* buffer, uint8_t* value) {
+	*value = (buffer[1] & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET
+		| (buffer[2] & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET;
+
+	return LED_COLOR_MASK | LED_BRIGHTNESS_MASK;
+}
+
+/// Processes a `0x10` / `Fade` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_effect_fade(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	uint8_t brightness = buffer[1];
+	uint16_t duration = buffer[2] | buffer[3] << 8;
+
+	led_effect_fade(brightness, duration);
+
+	return 0;
+}
+
+/// Processes a `0x11` / `Blink` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_effect_blink(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	uint16_t period = buffer[1] | buffer[2] << 8;
+
+	return led_effect_blink(period) ? 0 : MSG_ERROR_CODE_INVALID_PARAMETERS;
+}
+
+/// Processes a `0x12` / `Pulse` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_effect_pulse(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	uint16_t period = buffer[1] | buffer[2] << 8;
+
+	return led_effect_pulse(period) ? 0 : MSG_ERROR_CODE_INVALID_PARAMETERS;
+}
+
+/// Processes a `0x13` / `Effect Stop` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_effect_stop(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+	(void)buffer;
+
+	led_effect_stop();
+
+	return 0;
+}
+
+/// Number of bytes of the message of a `0x20` / `Schedule` op code message.
+#define MSG_SCHEDULE_MESSAGE_LENGTH 4
+
+/// Processes a `0x20` / `Schedule` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_schedule(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	uint8_t id = buffer[1];
+	uint16_t delay = buffer[2] | buffer[3] << 8;
+	const uint8_t* message = &buffer[4];
+	// Padding after the message is ignored; unknown op codes are rejected now
+	// instead of when the message is due.
+	uint8_t length = msg_frame_length(message[0]);
+
+	if (length == 0 || length > MSG_SCHEDULE_MESSAGE_LENGTH) {
+		return MSG_ERROR_CODE_INVALID_PARAMETERS;
+	}
+
+	return msg_sched_after(id, delay, length, message) ? 0 : MSG_ERROR_CODE_NO_RESOURCES;
+}
+
+/// Processes a `0x21` / `Cancel` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_cancel(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	msg_sched_cancel(buffer[1]);
+
+	return 0;
+}
+
+/// Processes a `0x30` - `0x3f` / `Preset Recall` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_preset_recall(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	led_preset_recall(buffer[0] - MSG_OP_CODE_PRESET_RECALL);
+
+	return 0;
+}
+
+/// Processes a `0x40` / `Preset Store` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_preset_store(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	return led_preset_store_current(buffer[1]) ? 0 : MSG_ERROR_CODE_INVALID_PARAMETERS;
+}
+
+/// Translates a register image of a message into the register layout of the board.
+///
+/// @param image The register image (see #MSG_IMAGE_STATE_OFFSET).
+///
+/// @return The register value.
+uint8_t msg_image_value(uint8_t image) {
+	return ((image >> MSG_IMAGE_STATE_OFFSET) & LED_STATE_VALUE_MASK) << LED_STATE_OFFSET
+		| ((image >> MSG_IMAGE_COLOR_OFFSET) & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET
+		| ((image >> MSG_IMAGE_BRIGHTNESS_OFFSET) & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET;
+}
+
+/// Processes a `0x41` / `Preset Store Value` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_preset_store_value(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	return led_preset_store(buffer[1], msg_image_value(buffer[2])) ? 0 : MSG_ERROR_CODE_INVALID_PARAMETERS;
+}
+
+/// Processes a `0x42` / `Scene Store` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_scene_store(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	uint8_t scene = buffer[1];
+	LedHandle first = buffer[2] | buffer[3] << 8;
+	uint8_t count = buffer[4];
+
+	return led_preset_scene_store(scene, first, count) ? 0 : MSG_ERROR_CODE_INVALID_PARAMETERS;
+}
+
+/// Processes a `0x43` / `Scene Recall` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_scene_recall(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	return led_preset_scene_recall(buffer[1]) ? 0 : MSG_ERROR_CODE_INVALID_PARAMETERS;
+}
+
+/// Changes the brightness by `delta` levels, saturating at #LED_BRIGHTNESS_MIN
+/// and #LED_BRIGHTNESS_MAX.
+///
+/// @param delta The number of levels.
+void msg_brightness_step(int delta) {
+	int brightness = ((led_value() >> LED_BRIGHTNESS_OFFSET) & LED_BRIGHTNESS_VALUE_MASK) + delta;
+
+	if (brightness < LED_BRIGHTNESS_MIN) {
+		brightness = LED_BRIGHTNESS_MIN;
+	} else if (brightness > LED_BRIGHTNESS_MAX) {
+		brightness = LED_BRIGHTNESS_MAX;
+	}
+
+	led_brightness_set((uint8_t)brightness);
+}
+
+/// Processes a `0x50` / `Brightness Up` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_brightness_up(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+	(void)buffer;
+
+	msg_brightness_step(1);
+
+	return 0;
+}
+
+/// Processes a `0x51` / `Brightness Down` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_brightness_down(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+	(void)buffer;
+
+	msg_brightness_step(-1);
+
+	return 0;
+}
+
+/// Processes a `0x52` / `Brightness Step` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_brightness_step(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	// Two's complement.
+	int delta = buffer[1] < 0x80 ? buffer[1] : buffer[1] - 0x100;
+
+	msg_brightness_step(delta);
+
+	return 0;
+}
+
+/// Processes a `0x53` / `Color Toggle` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_color_toggle(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	uint8_t color = (led_value() >> LED_COLOR_OFFSET) & LED_COLOR_VALUE_MASK;
+
+	led_color_set(color ^ buffer[1]);
+
+	return 0;
+}
+
+/// Register bits of a `0x54` / `Register Image` op code message (see #MsgOpBits).
+uint8_t bits_op_register_image(const uint8_t* buffer, uint8_t* value) {
+	*value = msg_image_value(buffer[1]);
+
+	return LED_STATE_MASK | LED_COLOR_MASK | LED_BRIGHTNESS_MASK;
+}
+
+/// Processes a `0x54` / `Register Image` op code message.
+///
+/// @param len The total length of the received message.
+/// @param buffer The complete message
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int process_op_register_image(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	uint8_t value;
+
+	bits_op_register_image(buffer, &value);
+	led_value_set(value);
+
+	return 0;
+}
+
+_Static_assert(LED_PRESET_SLOTS == 16, "The Preset Recall op codes cover 16 presets");
+
+/// Descriptor of the `Preset Recall` op codes (one per preset).
+#define MSG_PRESET_RECALL_DESCRIPTOR { process_op_preset_recall, 1, 1, { 0 } }
+
+/// Descriptors of all op codes, indexed by the op code.
+///
+/// Unknown op codes have no handler and a length range of `0..0`.
+MsgOpDescriptor msg_op_table[256] = {
+	[MSG_OP_CODE_ON]           = { process_op_on, 1, 1, { 0 }, bits_op_on },
+	[MSG_OP_CODE_OFF]          = { process_op_off, 1, 1, { 0 }, bits_op_off },
+	// Color bits `3:7`, brightness bits `4:7` are reserved.
+	[MSG_OP_CODE_LED_SETTINGS] = { process_op_led_settings, 3, 3, { 0xf8, 0xf0 }, bits_op_led_settings },
+	// Brightness bits `4:7` are reserved.
+	[MSG_OP_CODE_EFFECT_FADE]  = { process_op_effect_fade, 4, 4, { 0xf0 } },
+	[MSG_OP_CODE_EFFECT_BLINK] = { process_op_effect_blink, 3, 3, { 0 } },
+	[MSG_OP_CODE_EFFECT_PULSE] = { process_op_effect_pulse, 3, 3, { 0 } },
+	[MSG_OP_CODE_EFFECT_STOP]  = { process_op_effect_stop, 1, 1, { 0 } },
+	[MSG_OP_CODE_SCHEDULE]     = { process_op_schedule, 4 + MSG_SCHEDULE_MESSAGE_LENGTH, 4 + MSG_SCHEDULE_MESSAGE_LENGTH, { 0 } },
+	[MSG_OP_CODE_CANCEL]       = { process_op_cancel, 2, 2, { 0 } },
+	[MSG_OP_CODE_PRESET_RECALL + 0x0] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0x1] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0x2] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0x3] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0x4] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0x5] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0x6] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0x7] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0x8] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0x9] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0xa] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0xb] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0xc] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0xd] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0xe] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_RECALL + 0xf] = MSG_PRESET_RECALL_DESCRIPTOR,
+	[MSG_OP_CODE_PRESET_STORE]       = { process_op_preset_store, 2, 2, { 0 } },
+	[MSG_OP_CODE_PRESET_STORE_VALUE] = { process_op_preset_store_value, 3, 3, { 0 } },
+	[MSG_OP_CODE_SCENE_STORE]        = { process_op_scene_store, 5, 5, { 0 } },
+	[MSG_OP_CODE_SCENE_RECALL]       = { process_op_scene_recall, 2, 2, { 0 } },
+	[MSG_OP_CODE_BRIGHTNESS_UP]      = { process_op_brightness_up, 1, 1, { 0 } },
+	[MSG_OP_CODE_BRIGHTNESS_DOWN]    = { process_op_brightness_down, 1, 1, { 0 } },
+	[MSG_OP_CODE_BRIGHTNESS_STEP]    = { process_op_brightness_step, 2, 2, { 0 } },
+	// Color bits `3:7` are reserved.
+	[MSG_OP_CODE_COLOR_TOGGLE]       = { process_op_color_toggle, 2, 2, { 0xf8 } },
+	[MSG_OP_CODE_REGISTER_IMAGE]     = { process_op_register_image, 2, 2, { 0 }, bits_op_register_image },
+};
+
+bool msg_op_register(uint8_t op_code, const MsgOpDescriptor* descriptor) {
+	if (descriptor == NULL) {
+		msg_op_table[op_code] = (MsgOpDescriptor){ 0 };
+		return true;
+	}
+
+	if (descriptor->handler == NULL
+			|| descriptor->min_length < 1
+			|| descriptor->min_length > descriptor->max_length
+			|| descriptor->max_length > MSG_FRAME_MAX_LENGTH) {
+		return false;
+	}
+
+	msg_op_table[op_code] = *descriptor;
+
+	return true;
+}
+
+const MsgOpDescriptor* msg_op_descriptor(uint8_t op_code) {
+	return &msg_op_table[op_code];
+}
+
+int msg_decode(uint8_t bufferLength, const uint8_t* buffer, uint8_t* message) {
 	if (bufferLength < 1) {
 		return MSG_ERROR_CODE_EMPTY;
 	}
 
 	uint8_t op_code = buffer[0];
+	const MsgOpDescriptor* descriptor = &msg_op_table[op_code];
 
-	switch (op_code) {
-		case MSG_OP_CODE_ON:
-			return process_op_on(bufferLength);
-		case MSG_OP_CODE_OFF:
-			return process_op_off(bufferLength);
-		case MSG_OP_CODE_LED_SETTINGS:
-			return process_op_led_settings(bufferLength, buffer);
-		default:
+	// Single compare for `min_length <= bufferLength <= max_length`. Unknown op
+	// codes (`0..0`) always fail it.
+	if ((uint8_t)(bufferLength - descriptor->min_length) > (uint8_t)(descriptor->max_length - descriptor->min_length)) {
+		if (descriptor->handler == NULL) {
 			return MSG_ERROR_CODE_INVALID_OP_CODE;
+		} else if (bufferLength < descriptor->min_length) {
+			return MSG_ERROR_CODE_MISSING_PARAMETERS;
+		} else {
+			return MSG_ERROR_CODE_TRAILING_BYTES;
+		}
+	}
+
+	message[0] = op_code;
+
+	for (uint8_t i = 1; i < bufferLength; i++) {
+		message[i] = buffer[i] & ~descriptor->reserved[i - 1];
+	}
+
+	return 0;
+}
+
+int process_message(uint8_t bufferLength, const uint8_t* buffer) {
+	if (bufferLength < 1) {
+		STATS_ERROR(MSG_ERROR_CODE_EMPTY);
+		return MSG_ERROR_CODE_EMPTY;
+	}
+
+	STATS_LATENCY_START(start);
+
+	uint8_t op_code = buffer[0];
+	const MsgOpDescriptor* descriptor = &msg_op_table[op_code];
+	// Copy of the message without the reserved parameter bits.
+	uint8_t message[MSG_FRAME_MAX_LENGTH];
+	int status = msg_decode(bufferLength, buffer, message);
+
+	if (status == 0) {
+		// Collect all changes of the message into a single register write.
+		TRACE_OP_CODE_SET(op_code);
+		led_begin();
+		status = descriptor->handler(bufferLength, message);
+		led_commit();
+		TRACE_OP_CODE_SET(TRACE_NO_OP_CODE);
+	}
+
+	STATS_MESSAGE(op_code);
+	STATS_ERROR(status);
+	STATS_LATENCY_END(start, op_code);
+
+	return status;
+}
+
+/*
+ * Batches
+ */
+
+_Static_assert(MSG_BATCH_CHUNK > 0 && MSG_BATCH_CHUNK <= 64 && MSG_BATCH_CHUNK % 8 == 0, "MSG_BATCH_CHUNK must be a multiple of 8 and fit into an uint64_t bitmap");
+
+/// Records the failed messages of a chunk in order.
+///
+/// @param first Index of the first message of the chunk.
+/// @param failed Bitmap of the failed messages of the chunk.
+/// @param status Result of each message of the chunk.
+/// @param errors Receives the failed messages (may be `NULL`).
+/// @param errorsCapacity Number of entries which fit into errors.
+/// @param failures Number of failures recorded so far.
+///
+/// @return The number of failures including the ones of this chunk.
+size_t msg_batch_errors(size_t first, uint64_t failed, const uint8_t* status, MsgBatchError* errors, size_t errorsCapacity, size_t failures) {
+	while (failed != 0) {
+		unsigned i = (unsigned)__builtin_ctzll(failed);
+
+		if (errors != NULL && failures < errorsCapacity) {
+			errors[failures] = (MsgBatchError){ (uint32_t)(first + i), status[i] };
+		}
+
+		failures++;
+		failed &= failed - 1;
 	}
+
+	return failures;
+}
+
+size_t process_messages(const uint8_t* buffer, const MsgBatchEntry* entries, size_t count, uint8_t* successes, MsgBatchError* errors, size_t errorsCapacity) {
+	// Decoded messages of the current chunk (without reserved bits).
+	uint8_t messages[MSG_BATCH_CHUNK][MSG_FRAME_MAX_LENGTH];
+	uint8_t status[MSG_BATCH_CHUNK];
+	size_t failures = 0;
+
+	led_begin();
+
+	for (size_t first = 0; first < count; first += MSG_BATCH_CHUNK) {
+		size_t chunk = count - first < MSG_BATCH_CHUNK ? count - first : MSG_BATCH_CHUNK;
+		const MsgBatchEntry* chunk_entries = &entries[first];
+		uint64_t valid = 0;
+
+		// First pass: validate (and decode) all messages of the chunk.
+		for (size_t i = 0; i < chunk; i++) {
+			status[i] = (uint8_t)msg_decode(chunk_entries[i].length, &buffer[chunk_entries[i].offset], messages[i]);
+			valid |= (uint64_t)(status[i] == 0) << i;
+		}
+
+		// Second pass: apply the valid messages.
+		uint64_t pending = valid;
+
+		while (pending != 0) {
+			unsigned i = (unsigned)__builtin_ctzll(pending);
+			uint8_t op_code = messages[i][0];
+
+			TRACE_OP_CODE_SET(op_code);
+			status[i] = (uint8_t)msg_op_table[op_code].handler(chunk_entries[i].length, messages[i]);
+			valid &= ~((uint64_t)(status[i] != 0) << i);
+			pending &= pending - 1;
+		}
+
+		TRACE_OP_CODE_SET(TRACE_NO_OP_CODE);
+
+#ifdef LED_STATS
+		for (size_t i = 0; i < chunk; i++) {
+			if (chunk_entries[i].length > 0) {
+				STATS_MESSAGE(buffer[chunk_entries[i].offset]);
+			}
+
+			STATS_ERROR(status[i]);
+		}
+#endif
+
+		if (successes != NULL) {
+			for (size_t byte = 0; byte * 8 < chunk; byte++) {
+				successes[first / 8 + byte] = (uint8_t)(valid >> (byte * 8));
+			}
+		}
+
+		uint64_t chunk_mask = chunk == 64 ? UINT64_MAX : ((uint64_t)1 << chunk) - 1;
+
+		failures = msg_batch_errors(first, ~valid & chunk_mask, status, errors, errorsCapacity, failures);
+	}
+
+	led_commit();
+
+	return failures;
+}
+
+uint8_t msg_frame_length(uint8_t op_code) {
+	return msg_op_table[op_code].max_length;
+}
+
+/*
+ * Streaming
+ */
+
+void msg_stream_init(MsgStream* stream) {
+	stream->pending_length = 0;
+}
+
+/// Processes a single complete message of a stream and updates the statistics.
+///
+/// @param len The length of the message.
+/// @param buffer The complete message.
+/// @param results Optional (may be `NULL`), receives the result of the message at index `frames`.
+/// @param result The statistics to update.
+void msg_stream_process_frame(uint8_t len, const uint8_t* buffer, uint8_t* results, MsgStreamResult* result) {
+	int status = process_message(len, buffer);
+
+	if (results != NULL) {
+		results[result->frames] = (uint8_t)status;
+	}
+
+	result->frames++;
+
+	if (status != 0) {
+		result->errors++;
+		result->last_error = status;
+	}
+}
+
+size_t msg_stream_process(MsgStream* stream, size_t bufferLength, const uint8_t* buffer, MsgStreamResult* result) {
+	return msg_stream_process_results(stream, bufferLength, buffer, NULL, result);
+}
+
+size_t msg_stream_process_results(MsgStream* stream, size_t bufferLength, const uint8_t* buffer, uint8_t* results, MsgStreamResult* result) {
+	MsgStreamResult local = { 0 };
+	size_t offset = 0;
+
+	// Complete the partial message of the last call first.
+	if (stream->pending_length > 0) {
+		uint8_t frame_length = msg_frame_length(stream->pending[0]);
+		// The op code might have been unregistered in the meantime.
+		uint8_t needed = frame_length > stream->pending_length ? frame_length - stream->pending_length : 0;
+		size_t available = bufferLength < needed ? bufferLength : needed;
+
+		for (size_t i = 0; i < available; i++) {
+			stream->pending[stream->pending_length++] = buffer[i];
+		}
+
+		offset = available;
+
+		if (available < needed) {
+			// Still incomplete, wait for more data.
+			if (result != NULL) {
+				*result = local;
+			}
+
+			return 0;
+		}
+
+		msg_stream_process_frame(stream->pending_length, stream->pending, results, &local);
+		local.bytes += available;
+		stream->pending_length = 0;
+	}
+
+	// Complete messages are processed directly from the buffer (no copies).
+	while (offset < bufferLength) {
+		uint8_t frame_length = msg_frame_length(buffer[offset]);
+
+		if (frame_length == 0) {
+			// Can not be framed; process (reject) the single byte to resynchronize.
+			frame_length = 1;
+		}
+
+		if (bufferLength - offset < frame_length) {
+			break;
+		}
+
+		msg_stream_process_frame(frame_length, &buffer[offset], results, &local);
+		local.bytes += frame_length;
+		offset += frame_length;
+	}
+
+	// Keep the partial message at the end for the next call.
+	while (offset < bufferLength) {
+		stream->pending[stream->pending_length++] = buffer[offset++];
+	}
+
+	if (result != NULL) {
+		*result = local;
+	}
+
+	return local.frames;
 }
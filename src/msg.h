@@ -10,11 +10,36 @@
 //! | `0x00`          | ON           | -                               | Turns the led on                                                                                                                                          |
 //! | `0x01`          | OFF          | -                               | Turns the led off                                                                                                                                         |
 //! | `0x02`          | Led Settings | Color - 8bit; Brightness - 8bit | **Color Bits**: <br/> `0` Red <br/> `1` Green <br/> `2` Blue <br/> `3:7` Reserved <br/><br/> **Brightness**: <br/> `0:3` Brightness level <br/> `4:7` Reserved |
-//! | `0x03` - `0xff` | Reserved     |                                 |                                                                                                                                                           |
+//! | `0x03` - `0x0f` | Reserved     |                                 |                                                                                                                                                           |
+//! | `0x10`          | Fade         | Brightness - 8bit; Duration - 16bit | Fades the brightness to the given value (bits `4:7` reserved) over duration ticks (little endian). See led_effect.h                                   |
+//! | `0x11`          | Blink        | Period - 16bit                  | Blinks the led with the given period in ticks (little endian, at least `2`)                                                                              |
+//! | `0x12`          | Pulse        | Period - 16bit                  | Pulses the brightness with the given period in ticks (little endian, at least `2`)                                                                       |
+//! | `0x13`          | Effect Stop  | -                               | Stops all effects, the led keeps its current value                                                                                                        |
+//! | `0x14` - `0x1f` | Reserved     |                                 |                                                                                                                                                           |
+//! | `0x20`          | Schedule     | Id - 8bit; Delay - 16bit; Message - 4 x 8bit | Processes the message after delay ticks (little endian), replacing a pending message with the same id. The message is padded to 4 bytes, its length is given by its op code. See msg_sched.h |
+//! | `0x21`          | Cancel       | Id - 8bit                       | Cancels the pending message with the given id (if any)                                                                                                    |
+//! | `0x22` - `0x2f` | Reserved     |                                 |                                                                                                                                                           |
+//! | `0x30` - `0x3f` | Preset Recall | -                              | Applies preset `op code - 0x30` to the led. See led_preset.h                                                                                              |
+//! | `0x40`          | Preset Store | Slot - 8bit                     | Stores the current value of the led in the preset (`0` - `15`)                                                                                           |
+//! | `0x41`          | Preset Store Value | Slot - 8bit; Image - 8bit | Stores the register image in the preset (`0` - `15`). The image has the layout of Register Image on every board                                          |
+//! | `0x42`          | Scene Store  | Scene - 8bit; First - 16bit; Count - 8bit | Stores a snapshot of count leds of the led bank starting at first (little endian) in the scene (`0` - `3`, at most `64` leds)                    |
+//! | `0x43`          | Scene Recall | Scene - 8bit                    | Applies the snapshot of the scene to its leds                                                                                                             |
+//! | `0x44` - `0x4f` | Reserved     |                                 |                                                                                                                                                           |
+//! | `0x50`          | Brightness Up | -                              | Increases the brightness by one level (saturates at the maximum)                                                                                          |
+//! | `0x51`          | Brightness Down | -                            | Decreases the brightness by one level (saturates at the minimum)                                                                                          |
+//! | `0x52`          | Brightness Step | Delta - 8bit                 | Changes the brightness by delta levels (signed, two's complement; saturates at the minimum/maximum)                                                      |
+//! | `0x53`          | Color Toggle | Color - 8bit                    | Toggles the given color bits (bits as for Led Settings, `3:7` reserved)                                                                                   |
+//! | `0x54`          | Register Image | Image - 8bit                  | Sets state, color and brightness at once. **Image Bits**: <br/> `0` State <br/> `1:3` Color <br/> `4:7` Brightness <br/><br/> The image has this layout on every board (see #MSG_IMAGE_STATE_OFFSET) |
+//! | `0x55` - `0xff` | Reserved     |                                 |                                                                                                                                                           |
+//!
+//! The delta op codes (`0x50` - `0x54`) are the compact alternative to Led
+//! Settings for partial changes, each results in a single register write.
 
 #ifndef _MSG_H_
 #define _MSG_H_
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /// Defines the valid op codes which can be used in the message.
@@ -25,6 +50,38 @@ typedef enum {
 	MSG_OP_CODE_OFF          = 0x01,
 	/// Sets the color and/or brightness of the led.
 	MSG_OP_CODE_LED_SETTINGS = 0x02,
+	/// Starts fading the brightness (see led_effect_fade()).
+	MSG_OP_CODE_EFFECT_FADE  = 0x10,
+	/// Starts blinking the led (see led_effect_blink()).
+	MSG_OP_CODE_EFFECT_BLINK = 0x11,
+	/// Starts pulsing the brightness (see led_effect_pulse()).
+	MSG_OP_CODE_EFFECT_PULSE = 0x12,
+	/// Stops all effects (see led_effect_stop()).
+	MSG_OP_CODE_EFFECT_STOP  = 0x13,
+	/// Schedules a message (see msg_sched_after()).
+	MSG_OP_CODE_SCHEDULE     = 0x20,
+	/// Cancels a scheduled message (see msg_sched_cancel()).
+	MSG_OP_CODE_CANCEL       = 0x21,
+	/// Applies a preset, the preset is given by `op code - MSG_OP_CODE_PRESET_RECALL` (see led_preset_recall()).
+	MSG_OP_CODE_PRESET_RECALL = 0x30,
+	/// Stores the current value of the led in a preset (see led_preset_store_current()).
+	MSG_OP_CODE_PRESET_STORE = 0x40,
+	/// Stores a board independent register image in a preset (see led_preset_store(), #MSG_IMAGE_STATE_OFFSET).
+	MSG_OP_CODE_PRESET_STORE_VALUE = 0x41,
+	/// Stores a snapshot of a group of leds in a scene (see led_preset_scene_store()).
+	MSG_OP_CODE_SCENE_STORE  = 0x42,
+	/// Applies a scene (see led_preset_scene_recall()).
+	MSG_OP_CODE_SCENE_RECALL = 0x43,
+	/// Increases the brightness by one level.
+	MSG_OP_CODE_BRIGHTNESS_UP   = 0x50,
+	/// Decreases the brightness by one level.
+	MSG_OP_CODE_BRIGHTNESS_DOWN = 0x51,
+	/// Changes the brightness by a signed number of levels.
+	MSG_OP_CODE_BRIGHTNESS_STEP = 0x52,
+	/// Toggles color bits.
+	MSG_OP_CODE_COLOR_TOGGLE    = 0x53,
+	/// Sets the whole led register from a board independent image (see #MSG_IMAGE_STATE_OFFSET).
+	MSG_OP_CODE_REGISTER_IMAGE  = 0x54,
 } MsgOpCode;
 
 /// Defines the errors which might occur during the message processing.
@@ -37,14 +94,225 @@ typedef enum {
 	MSG_ERROR_CODE_TRAILING_BYTES     = 20,
 	/// The message was missing some parameters.
 	MSG_ERROR_CODE_MISSING_PARAMETERS = 30,
+	/// The parameters of the message are out of range.
+	MSG_ERROR_CODE_INVALID_PARAMETERS = 40,
+	/// No resources (e.g. a free slot) where available to process the message.
+	MSG_ERROR_CODE_NO_RESOURCES       = 50,
 } MsgErrorCode;
 
+/// Maximum length of a single message (op code and parameters).
+#define MSG_FRAME_MAX_LENGTH 8
+
+/// Maximum number of parameters of a single message.
+#define MSG_MAX_PARAMETERS (MSG_FRAME_MAX_LENGTH - 1)
+
+/// Bit offset of the state in the image of a `Register Image` or `Preset Store Value` message.
+///
+/// The image has the same layout on every board (the default layout, see
+/// led.h), it is translated into the register layout of the board.
+#define MSG_IMAGE_STATE_OFFSET      0
+/// Bit offset of the color in the image of a `Register Image` message.
+#define MSG_IMAGE_COLOR_OFFSET      1
+/// Bit offset of the brightness in the image of a `Register Image` message.
+#define MSG_IMAGE_BRIGHTNESS_OFFSET 4
+
+/// Number of messages which process_messages() validates before applying them.
+#define MSG_BATCH_CHUNK 64
+
+/// Processes a message with a specific op code.
+///
+/// The length of the message is already validated against the #MsgOpDescriptor
+/// of the op code and all reserved parameter bits are cleared.
+///
+/// @param len The total length of the message.
+/// @param buffer The complete message.
+///
+/// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode should be returned.
+typedef int (*MsgOpHandler)(uint8_t len, const uint8_t* buffer);
+
+/// Translates a message into the led register bits it sets.
+///
+/// Used to merge messages before they are applied (see msg_coalesce.h). The
+/// message is validated like for a #MsgOpHandler.
+///
+/// @param buffer The complete message.
+/// @param value Receives the value of the bits which are set.
+///
+/// @return The mask of the bits which are set by the message.
+typedef uint8_t (*MsgOpBits)(const uint8_t* buffer, uint8_t* value);
+
+/// Describes how messages of an op code are validated and processed.
+typedef struct {
+	/// The handler of the op code (`NULL` if the op code is not known).
+	MsgOpHandler handler;
+	/// The minimum length of the message (op code and parameters).
+	uint8_t min_length;
+	/// The maximum length of the message (op code and parameters).
+	uint8_t max_length;
+	/// Bits of each parameter which are reserved. They are cleared before the
+	/// message is passed to the handler.
+	uint8_t reserved[MSG_MAX_PARAMETERS];
+	/// Optional (may be `NULL`), translates the message into register bits.
+	/// Only messages which only set register bits of the led can have one.
+	MsgOpBits bits;
+} MsgOpDescriptor;
+
+/// State of a streaming decoder.
+///
+/// Holds the bytes of a partial message which did not fit into the buffer
+/// passed to msg_stream_process() until the rest of it arrives.
+///
+/// Must be initialized with msg_stream_init() before use.
+typedef struct {
+	/// Received bytes of the partial message.
+	uint8_t pending[MSG_FRAME_MAX_LENGTH];
+	/// Number of valid bytes in `pending`.
+	uint8_t pending_length;
+} MsgStream;
+
+/// Statistics of a single msg_stream_process() call.
+typedef struct {
+	/// Number of bytes from the buffer which belonged to processed messages.
+	///
+	/// Bytes which are kept in the stream as part of a partial message are not
+	/// counted.
+	size_t bytes;
+	/// Number of messages which where processed (successfully or not).
+	size_t frames;
+	/// Number of messages which failed to process.
+	size_t errors;
+	/// The last error which occurred (`0` if none occurred).
+	int last_error;
+} MsgStreamResult;
+
+/// Location of a message within the buffer of a batch (see process_messages()).
+typedef struct {
+	/// Offset of the message in the buffer.
+	uint32_t offset;
+	/// Length of the message.
+	uint8_t length;
+} MsgBatchEntry;
+
+/// A message of a batch which failed to process.
+typedef struct {
+	/// Index of the message within the batch.
+	uint32_t index;
+	/// The variant of #MsgErrorCode.
+	uint8_t error;
+} MsgBatchError;
+
 /// Processes the message in buffer and set the led accordingly.
 ///
 /// @param bufferLength The length of the message in buffer.
 /// @param buffer The buffer which holds the messages to be processed.
 ///
 /// @return Returns `0` if the message was processed successfully, otherwise a variant of #MsgErrorCode will be returned.
-int process_message(uint8_t bufferLength, uint8_t* buffer);
+///
+/// # NOTE
+/// The message is applied inside a led transaction (see led_begin()), so each
+/// message results in at most one write of the led register.
+int process_message(uint8_t bufferLength, const uint8_t* buffer);
+
+/// Processes a batch of messages in order.
+///
+/// The messages are validated in chunks of #MSG_BATCH_CHUNK messages first
+/// (see msg_decode()), then the valid messages of the chunk are applied
+/// without further checks. The whole batch is applied inside a single led
+/// transaction (see led_begin()), so it results in at most one write of the
+/// led register.
+///
+/// @param buffer The buffer which holds the messages.
+/// @param entries The location of each message in buffer.
+/// @param count The number of messages.
+/// @param successes Optional (may be `NULL`), receives a bitmap of the messages which where processed successfully (bit `i % 8` of byte `i / 8` for message `i`, at least `(count + 7) / 8` bytes).
+/// @param errors Optional (may be `NULL`), receives the failed messages in order.
+/// @param errorsCapacity Number of entries which fit into errors (further failures are only counted).
+///
+/// @return The number of messages which failed to process.
+size_t process_messages(const uint8_t* buffer, const MsgBatchEntry* entries, size_t count, uint8_t* successes, MsgBatchError* errors, size_t errorsCapacity);
+
+/// Validates a message against the descriptor of its op code and copies it
+/// without the reserved parameter bits.
+///
+/// This is the validation done by process_message(), without processing the
+/// message.
+///
+/// @param bufferLength The length of the message in buffer.
+/// @param buffer The buffer which holds the message.
+/// @param message Receives the message without reserved bits (at least #MSG_FRAME_MAX_LENGTH bytes).
+///
+/// @return Returns `0` if the message is valid, otherwise a variant of #MsgErrorCode will be returned.
+int msg_decode(uint8_t bufferLength, const uint8_t* buffer, uint8_t* message);
+
+/// Registers (or replaces) the descriptor of an op code.
+///
+/// Allows to add op codes without changing the message processing itself.
+///
+/// @param op_code The op code to register.
+/// @param descriptor The descriptor to copy into the op code table, `NULL` to unregister the op code.
+///
+/// @return `true` if the descriptor was registered, `false` if it has no handler or its lengths are invalid.
+///
+/// # Example
+/// ```c
+/// int process_op_blink(uint8_t len, const uint8_t* buffer);
+///
+/// MsgOpDescriptor blink = { process_op_blink, 2, 2, { 0xf0 }, NULL };
+/// msg_op_register(0x80, &blink);
+/// ```
+bool msg_op_register(uint8_t op_code, const MsgOpDescriptor* descriptor);
+
+/// Returns the descriptor of an op code.
+///
+/// @param op_code The op code.
+///
+/// @return The descriptor; its handler is `NULL` if the op code is not known.
+const MsgOpDescriptor* msg_op_descriptor(uint8_t op_code);
+
+/// Returns the length of a message (op code and parameters) starting with
+/// `op_code`.
+///
+/// For op codes with a variable length, the maximum length is returned.
+///
+/// @param op_code The op code of the message.
+///
+/// @return The length of the message or `0` if the op code is not known.
+uint8_t msg_frame_length(uint8_t op_code);
+
+/// Initializes (or resets) a streaming decoder.
+///
+/// @param stream The stream to initialize.
+void msg_stream_init(MsgStream* stream);
+
+/// Processes a buffer of back-to-back messages.
+///
+/// Messages are framed by the length of their op code (see
+/// msg_frame_length()) and processed with process_message() directly from
+/// `buffer`. A partial message at the end of `buffer` is kept in `stream` and
+/// completed by the next call.
+///
+/// An unknown op code can not be framed. It is counted as a failed message of
+/// a single byte (#MSG_ERROR_CODE_INVALID_OP_CODE) and decoding continues with
+/// the next byte.
+///
+/// @param stream The stream state (see msg_stream_init()).
+/// @param bufferLength The length of buffer.
+/// @param buffer The buffer which holds the messages to be processed.
+/// @param result Optional (may be `NULL`), receives the statistics of this call.
+///
+/// @return The number of messages which where processed (successfully or not).
+size_t msg_stream_process(MsgStream* stream, size_t bufferLength, const uint8_t* buffer, MsgStreamResult* result);
+
+/// Same as msg_stream_process(), additionally returns the result of every
+/// processed message (e.g. to reply to the sender).
+///
+/// @param stream The stream state (see msg_stream_init()).
+/// @param bufferLength The length of buffer.
+/// @param buffer The buffer which holds the messages to be processed.
+/// @param results Receives the result (`0` or a variant of #MsgErrorCode) of each processed message in order (at least `bufferLength + 1` bytes).
+/// @param result Optional (may be `NULL`), receives the statistics of this call.
+///
+/// @return The number of messages which where processed (successfully or not).
+size_t msg_stream_process_results(MsgStream* stream, size_t bufferLength, const uint8_t* buffer, uint8_t* results, MsgStreamResult* result);
 
 #endif
@@ -0,0 +1,125 @@
+//! \file msg_coalesce.c
+//! Implementation for the coalescing ingestion of messages.
+//!
+//! See msg_coalesce.h for the available functions and documentation.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "led.h"
+#include "msg.h"
+#include "msg_coalesce.h"
+#include "stats.h"
+
+/// Register bits of each merged field.
+const uint8_t msg_coalesce_fields[MSG_COALESCE_FIELDS] = {
+	LED_STATE_MASK,
+	LED_COLOR_MASK,
+	LED_BRIGHTNESS_MASK,
+};
+
+void msg_coalesce_init(MsgCoalesce* coalesce) {
+	*coalesce = (MsgCoalesce){ 0 };
+}
+
+/// Applies the merged register bits with a single led transaction.
+///
+/// @param coalesce The state.
+///
+/// @return `true` if the led register was written, `false` otherwise.
+bool msg_coalesce_apply(MsgCoalesce* coalesce) {
+	if (coalesce->pending == 0) {
+		return false;
+	}
+
+	// Messages which are still the last writer of at least one field are
+	// applied, all others where fully superseded.
+	size_t applied = 0;
+
+	for (size_t field = 0; field < MSG_COALESCE_FIELDS; field++) {
+		uint32_t writer = coalesce->writers[field];
+		bool counted = writer == 0;
+
+		for (size_t other = 0; other < field && !counted; other++) {
+			counted = coalesce->writers[other] == writer;
+		}
+
+		applied += counted ? 0 : 1;
+	}
+
+	coalesce->coalesced += coalesce->pending - applied;
+	coalesce->total_coalesced += coalesce->pending - applied;
+
+	led_begin();
+	led_value_set((led_value() & ~coalesce->mask) | (coalesce->value & coalesce->mask));
+	bool written = led_commit();
+
+	coalesce->value = 0;
+	coalesce->mask = 0;
+	coalesce->pending = 0;
+
+	for (size_t field = 0; field < MSG_COALESCE_FIELDS; field++) {
+		coalesce->writers[field] = 0;
+	}
+
+	return written;
+}
+
+int msg_coalesce_add(MsgCoalesce* coalesce, uint8_t bufferLength, const uint8_t* buffer) {
+	uint8_t message[MSG_FRAME_MAX_LENGTH];
+
+	// Invalid messages are rejected by process_message() (no need to apply
+	// the merged messages first, they have no effect).
+	if (msg_decode(bufferLength, buffer, message) != 0) {
+		return process_message(bufferLength, buffer);
+	}
+
+	const MsgOpDescriptor* descriptor = msg_op_descriptor(message[0]);
+
+	if (descriptor->bits == NULL) {
+		// Keep the order of the messages.
+		msg_coalesce_apply(coalesce);
+
+		return process_message(bufferLength, buffer);
+	}
+
+	uint8_t value;
+	uint8_t mask = descriptor->bits(message, &value);
+
+	coalesce->value = (coalesce->value & ~mask) | (value & mask);
+	coalesce->mask |= mask;
+	coalesce->pending++;
+	coalesce->messages++;
+	coalesce->total_messages++;
+
+	for (size_t field = 0; field < MSG_COALESCE_FIELDS; field++) {
+		if (mask & msg_coalesce_fields[field]) {
+			coalesce->writers[field] = coalesce->pending;
+		}
+	}
+
+	STATS_MESSAGE(message[0]);
+
+	return 0;
+}
+
+size_t msg_coalesce_drain(MsgCoalesce* coalesce, MsgCoalesceResult* result) {
+	bool written = msg_coalesce_apply(coalesce);
+	size_t messages = coalesce->messages;
+
+	if (result != NULL) {
+		result->messages = messages;
+		result->coalesced = coalesce->coalesced;
+		result->written = written;
+	}
+
+	coalesce->messages = 0;
+	coalesce->coalesced = 0;
+
+	return messages;
+}
+
+size_t msg_coalesce_coalesced(const MsgCoalesce* coalesce) {
+	return coalesce->total_coalesced;
+}
@@ -0,0 +1,109 @@
+//! \file msg_coalesce.h
+//!
+//! Coalescing ingestion of messages.
+//!
+//! Messages which only set register fields of the led (state, color,
+//! brightness; see #MsgOpBits) are not applied immediately but merged per
+//! field, the last message setting a field wins. msg_coalesce_drain() applies
+//! the net effect of all merged messages with a single register write:
+//!
+//! ```c
+//! MsgCoalesce coalesce; // msg_coalesce_init(&coalesce) during startup
+//!
+//! void on_receive(uint8_t len, const uint8_t* buffer) {
+//!     msg_coalesce_add(&coalesce, len, buffer);
+//! }
+//!
+//! void main_loop(void) {
+//!     for (;;) {
+//!         msg_coalesce_drain(&coalesce, NULL);
+//!     }
+//! }
+//! ```
+//!
+//! # NOTE
+//! Messages which can not be merged (e.g. effects, presets) are processed
+//! immediately with process_message(), after the merged messages received
+//! before them were applied. So the order of all messages is kept.
+//!
+//! The message protocol only addresses the single led, so there is a single
+//! set of fields per #MsgCoalesce.
+
+#ifndef _MSG_COALESCE_H_
+#define _MSG_COALESCE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "msg.h"
+
+/// Number of register fields which are merged (state, color, brightness).
+#define MSG_COALESCE_FIELDS 3
+
+/// State of a coalescing ingestion.
+///
+/// Must be initialized with msg_coalesce_init() before use.
+typedef struct {
+	/// Value of the merged register bits.
+	uint8_t value;
+	/// Mask of the merged register bits.
+	uint8_t mask;
+	/// Number of merged messages which are not applied yet.
+	uint32_t pending;
+	/// Message (`1` based index within the pending messages) which set each field last (`0` if none).
+	uint32_t writers[MSG_COALESCE_FIELDS];
+	/// Number of messages merged since the last drain.
+	size_t messages;
+	/// Number of messages since the last drain which where fully superseded.
+	size_t coalesced;
+	/// Number of messages merged since the initialization.
+	size_t total_messages;
+	/// Number of messages since the initialization which where fully superseded.
+	size_t total_coalesced;
+} MsgCoalesce;
+
+/// Statistics of a single msg_coalesce_drain() call.
+typedef struct {
+	/// Number of messages which where merged since the last drain.
+	size_t messages;
+	/// Number of those messages which where fully superseded by later
+	/// messages and therefore never applied.
+	size_t coalesced;
+	/// `true` if the led register was written.
+	bool written;
+} MsgCoalesceResult;
+
+/// Initializes (or resets) a coalescing ingestion.
+///
+/// @param coalesce The state to initialize.
+void msg_coalesce_init(MsgCoalesce* coalesce);
+
+/// Adds a message.
+///
+/// Messages with register bits (see #MsgOpBits) are validated and merged.
+/// All other messages are processed immediately with process_message().
+///
+/// @param coalesce The state.
+/// @param bufferLength The length of the message in buffer.
+/// @param buffer The buffer which holds the message.
+///
+/// @return Returns `0` if the message was merged or processed successfully, otherwise a variant of #MsgErrorCode will be returned.
+int msg_coalesce_add(MsgCoalesce* coalesce, uint8_t bufferLength, const uint8_t* buffer);
+
+/// Applies the net effect of all merged messages with a single led
+/// transaction (see led_begin()).
+///
+/// @param coalesce The state.
+/// @param result Optional (may be `NULL`), receives the statistics of this call.
+///
+/// @return The number of messages which where merged since the last drain.
+size_t msg_coalesce_drain(MsgCoalesce* coalesce, MsgCoalesceResult* result);
+
+/// Returns the number of messages which where fully superseded since the
+/// initialization.
+///
+/// @param coalesce The state.
+size_t msg_coalesce_coalesced(const MsgCoalesce* coalesce);
+
+#endif
@@ -0,0 +1,94 @@
+//! \file msg_queue.c
+//! Implementation for the message queue.
+//!
+//! See msg_queue.h for the available functions and documentation.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "led.h"
+#include "msg.h"
+#include "msg_queue.h"
+
+_Static_assert((MSG_QUEUE_CAPACITY & (MSG_QUEUE_CAPACITY - 1)) == 0, "MSG_QUEUE_CAPACITY must be a power of two");
+
+void msg_queue_init(MsgQueue* queue) {
+	atomic_init(&queue->head, 0);
+	atomic_init(&queue->dropped, 0);
+	atomic_init(&queue->tail, 0);
+}
+
+bool msg_queue_enqueue(MsgQueue* queue, uint8_t bufferLength, const uint8_t* buffer) {
+	// Only the producer writes head, only the consumer writes tail.
+	size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+	if (head - tail >= MSG_QUEUE_CAPACITY) {
+		atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+		return false;
+	}
+
+	MsgQueueSlot* slot = &queue->slots[head & (MSG_QUEUE_CAPACITY - 1)];
+	uint8_t length = bufferLength < MSG_QUEUE_MESSAGE_SIZE ? bufferLength : MSG_QUEUE_MESSAGE_SIZE;
+
+	for (uint8_t i = 0; i < length; i++) {
+		slot->data[i] = buffer[i];
+	}
+
+	slot->length = length;
+
+	// Publish the slot to the consumer.
+	atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+
+	return true;
+}
+
+size_t msg_queue_drain(MsgQueue* queue, size_t max_messages, MsgQueueDrainResult* result) {
+	MsgQueueDrainResult local = { 0 };
+
+	size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+	size_t count = head - tail;
+
+	if (count > max_messages) {
+		count = max_messages;
+	}
+
+	led_begin();
+
+	for (size_t i = 0; i < count; i++) {
+		MsgQueueSlot* slot = &queue->slots[(tail + i) & (MSG_QUEUE_CAPACITY - 1)];
+		int status = process_message(slot->length, slot->data);
+
+		if (status != 0) {
+			local.errors++;
+			local.last_error = status;
+		}
+	}
+
+	led_commit();
+
+	// Release all processed slots at once.
+	atomic_store_explicit(&queue->tail, tail + count, memory_order_release);
+
+	local.messages = count;
+
+	if (result != NULL) {
+		*result = local;
+	}
+
+	return count;
+}
+
+size_t msg_queue_size(MsgQueue* queue) {
+	size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+	size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+	return head - tail;
+}
+
+size_t msg_queue_dropped(MsgQueue* queue) {
+	return atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,118 @@
+//! \file msg_queue.h
+//!
+//! Fixed capacity single-producer/single-consumer queue of messages.
+//!
+//! Allows to defer the processing of messages from the receiving context
+//! (e.g. an interrupt handler) to the main loop:
+//!
+//! ```c
+//! MsgQueue queue; // msg_queue_init(&queue) during startup
+//!
+//! void on_receive(uint8_t len, const uint8_t* buffer) {
+//!     msg_queue_enqueue(&queue, len, buffer); // O(1), never blocks
+//! }
+//!
+//! void main_loop(void) {
+//!     for (;;) {
+//!         msg_queue_drain(&queue, MSG_QUEUE_CAPACITY, NULL);
+//!     }
+//! }
+//! ```
+//!
+//! # NOTE
+//! The queue is lock-free and does not allocate. It is only safe with exactly
+//! one producer and one consumer.
+
+#ifndef _MSG_QUEUE_H_
+#define _MSG_QUEUE_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "msg.h"
+
+/// Number of messages the queue can hold (must be a power of two).
+#ifndef MSG_QUEUE_CAPACITY
+#define MSG_QUEUE_CAPACITY 64
+#endif
+
+/// Number of bytes stored per message.
+///
+/// Longer messages are truncated to this length. As they are longer than any
+/// valid message, processing still fails with the same error.
+#define MSG_QUEUE_MESSAGE_SIZE (MSG_FRAME_MAX_LENGTH + 1)
+
+/// Alignment used to keep producer and consumer state on separate cache lines.
+#define MSG_QUEUE_CACHE_LINE 64
+
+/// A queued message.
+typedef struct {
+	/// The length of the message.
+	uint8_t length;
+	/// The message.
+	uint8_t data[MSG_QUEUE_MESSAGE_SIZE];
+} MsgQueueSlot;
+
+/// A single-producer/single-consumer message queue.
+///
+/// Must be initialized with msg_queue_init() before use.
+typedef struct {
+	/// Storage for the queued messages.
+	MsgQueueSlot slots[MSG_QUEUE_CAPACITY];
+	/// Number of enqueued messages (only written by the producer).
+	_Alignas(MSG_QUEUE_CACHE_LINE) atomic_size_t head;
+	/// Number of messages which where dropped because the queue was full (only written by the producer).
+	atomic_size_t dropped;
+	/// Number of dequeued messages (only written by the consumer).
+	_Alignas(MSG_QUEUE_CACHE_LINE) atomic_size_t tail;
+} MsgQueue;
+
+/// Statistics of a single msg_queue_drain() call.
+typedef struct {
+	/// Number of messages which where processed (successfully or not).
+	size_t messages;
+	/// Number of messages which failed to process.
+	size_t errors;
+	/// The last error which occurred (`0` if none occurred).
+	int last_error;
+} MsgQueueDrainResult;
+
+/// Initializes (or resets) a queue.
+///
+/// @param queue The queue to initialize.
+void msg_queue_init(MsgQueue* queue);
+
+/// Copies a message into the queue (producer side).
+///
+/// @param queue The queue.
+/// @param bufferLength The length of the message in buffer.
+/// @param buffer The buffer which holds the message.
+///
+/// @return `true` if the message was queued, `false` if the queue was full and the message was dropped.
+bool msg_queue_enqueue(MsgQueue* queue, uint8_t bufferLength, const uint8_t* buffer);
+
+/// Processes up to `max_messages` queued messages with process_message() (consumer side).
+///
+/// All messages of a call are applied inside a single led transaction (see
+/// led_begin()), so a drain results in at most one write of the led register.
+///
+/// @param queue The queue.
+/// @param max_messages The maximum number of messages to process.
+/// @param result Optional (may be `NULL`), receives the statistics of this call.
+///
+/// @return The number of messages which where processed (successfully or not).
+size_t msg_queue_drain(MsgQueue* queue, size_t max_messages, MsgQueueDrainResult* result);
+
+/// Returns the number of queued messages.
+///
+/// @param queue The queue.
+size_t msg_queue_size(MsgQueue* queue);
+
+/// Returns the number of messages which where dropped because the queue was full.
+///
+/// @param queue The queue.
+size_t msg_queue_dropped(MsgQueue* queue);
+
+#endif
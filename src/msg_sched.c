@@ -0,0 +1,335 @@
+//! \file msg_sched.c
+//! Implementation for the message scheduler.
+//!
+//! See msg_sched.h for the available functions and documentation.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "led.h"
+#include "msg.h"
+#include "msg_sched.h"
+
+/// Reference to no slot (end of a list / id not pending).
+///
+/// Slots are referenced by their index plus one, so a zero initialized
+/// scheduler is empty.
+#define MSG_SCHED_NO_SLOT 0
+
+/// Mask of the bucket index within a level.
+#define MSG_SCHED_WHEEL_MASK (MSG_SCHED_WHEEL_SIZE - 1)
+
+_Static_assert(MSG_SCHED_CAPACITY > 0 && MSG_SCHED_CAPACITY <= UINT8_MAX, "MSG_SCHED_CAPACITY must be between 1 and 255");
+_Static_assert(MSG_SCHED_WHEEL_BITS * MSG_SCHED_WHEEL_LEVELS < 32, "The wheel must cover less than 32bit of time");
+
+/// A pending message.
+typedef struct {
+	/// The tick the message is due at.
+	uint32_t due;
+	/// Bucket the slot is linked into (`level * MSG_SCHED_WHEEL_SIZE + index`).
+	uint16_t bucket;
+	/// Next slot in the bucket (or the free list).
+	uint8_t next;
+	/// Previous slot in the bucket.
+	uint8_t prev;
+	/// The id of the message.
+	uint8_t id;
+	/// The length of the message.
+	uint8_t length;
+	/// The message.
+	uint8_t message[MSG_FRAME_MAX_LENGTH];
+} MsgSchedSlot;
+
+/// State of the scheduler.
+typedef struct {
+	/// The last tick which was processed.
+	uint32_t now;
+	/// Number of pending messages.
+	size_t pending;
+	/// Number of pending messages of each level.
+	size_t level_pending[MSG_SCHED_WHEEL_LEVELS];
+	/// First released slot.
+	uint8_t free;
+	/// Number of slots which where never used.
+	uint8_t unused;
+	/// Slot of each id.
+	uint8_t ids[256];
+	/// First slot of each bucket.
+	uint8_t buckets[MSG_SCHED_WHEEL_LEVELS * MSG_SCHED_WHEEL_SIZE];
+	/// Storage for the pending messages.
+	MsgSchedSlot slots[MSG_SCHED_CAPACITY];
+} MsgSched;
+
+MsgSched msg_sched = { .unused = MSG_SCHED_CAPACITY };
+
+/// Returns the slot referenced by `index`.
+///
+/// @param index The reference of the slot (not #MSG_SCHED_NO_SLOT).
+MsgSchedSlot* msg_sched_slot(uint8_t index) {
+	return &msg_sched.slots[index - 1];
+}
+
+void msg_sched_init(uint32_t now) {
+	msg_sched.now = now;
+	msg_sched.pending = 0;
+
+	for (size_t level = 0; level < MSG_SCHED_WHEEL_LEVELS; level++) {
+		msg_sched.level_pending[level] = 0;
+	}
+
+	for (size_t id = 0; id < 256; id++) {
+		msg_sched.ids[id] = MSG_SCHED_NO_SLOT;
+	}
+
+	for (size_t bucket = 0; bucket < MSG_SCHED_WHEEL_LEVELS * MSG_SCHED_WHEEL_SIZE; bucket++) {
+		msg_sched.buckets[bucket] = MSG_SCHED_NO_SLOT;
+	}
+
+	msg_sched.free = MSG_SCHED_NO_SLOT;
+	msg_sched.unused = MSG_SCHED_CAPACITY;
+}
+
+/// Returns the bucket for a message due at `due`, relative to the current time.
+///
+/// @param due The tick the message is due at (not before the current time).
+///
+/// @return The bucket (`level * MSG_SCHED_WHEEL_SIZE + index`).
+uint16_t msg_sched_bucket(uint32_t due) {
+	uint32_t now = msg_sched.now;
+
+	for (uint16_t level = 0; level < MSG_SCHED_WHEEL_LEVELS; level++) {
+		uint32_t shift = level * MSG_SCHED_WHEEL_BITS;
+		// Distance in buckets of this level (masked, so it survives wrap arounds).
+		uint32_t distance = ((due >> shift) - (now >> shift)) & (UINT32_MAX >> shift);
+
+		if (distance < MSG_SCHED_WHEEL_SIZE) {
+			return level * MSG_SCHED_WHEEL_SIZE + ((due >> shift) & MSG_SCHED_WHEEL_MASK);
+		}
+	}
+
+	// Out of range, park in the farthest bucket of the last level. It is
+	// placed again once that bucket is cascaded.
+	uint32_t shift = (MSG_SCHED_WHEEL_LEVELS - 1) * MSG_SCHED_WHEEL_BITS;
+
+	return (MSG_SCHED_WHEEL_LEVELS - 1) * MSG_SCHED_WHEEL_SIZE + (((now >> shift) - 1) & MSG_SCHED_WHEEL_MASK);
+}
+
+/// Links a slot into the bucket of its due time.
+///
+/// @param index The slot.
+void msg_sched_link(uint8_t index) {
+	MsgSchedSlot* slot = msg_sched_slot(index);
+	uint16_t bucket = msg_sched_bucket(slot->due);
+	uint8_t head = msg_sched.buckets[bucket];
+
+	slot->bucket = bucket;
+	slot->prev = MSG_SCHED_NO_SLOT;
+	slot->next = head;
+
+	if (head != MSG_SCHED_NO_SLOT) {
+		msg_sched_slot(head)->prev = index;
+	}
+
+	msg_sched.buckets[bucket] = index;
+	msg_sched.level_pending[bucket / MSG_SCHED_WHEEL_SIZE]++;
+}
+
+/// Unlinks a slot from its bucket.
+///
+/// @param index The slot.
+void msg_sched_unlink(uint8_t index) {
+	MsgSchedSlot* slot = msg_sched_slot(index);
+
+	if (slot->prev != MSG_SCHED_NO_SLOT) {
+		msg_sched_slot(slot->prev)->next = slot->next;
+	} else {
+		msg_sched.buckets[slot->bucket] = slot->next;
+	}
+
+	if (slot->next != MSG_SCHED_NO_SLOT) {
+		msg_sched_slot(slot->next)->prev = slot->prev;
+	}
+
+	msg_sched.level_pending[slot->bucket / MSG_SCHED_WHEEL_SIZE]--;
+}
+
+/// Unlinks a slot and returns it to the free list.
+///
+/// @param index The slot.
+void msg_sched_release(uint8_t index) {
+	MsgSchedSlot* slot = msg_sched_slot(index);
+
+	msg_sched_unlink(index);
+	msg_sched.ids[slot->id] = MSG_SCHED_NO_SLOT;
+	msg_sched.pending--;
+
+	slot->next = msg_sched.free;
+	msg_sched.free = index;
+}
+
+bool msg_sched_at(uint8_t id, uint32_t time, uint8_t bufferLength, const uint8_t* buffer) {
+	if (bufferLength > MSG_FRAME_MAX_LENGTH) {
+		return false;
+	}
+
+	msg_sched_cancel(id);
+
+	uint8_t index = msg_sched.free;
+
+	if (index != MSG_SCHED_NO_SLOT) {
+		msg_sched.free = msg_sched_slot(index)->next;
+	} else if (msg_sched.unused > 0) {
+		index = MSG_SCHED_CAPACITY - --msg_sched.unused;
+	} else {
+		return false;
+	}
+
+	MsgSchedSlot* slot = msg_sched_slot(index);
+
+	// The current tick was already processed.
+	if ((int32_t)(time - msg_sched.now) <= 0) {
+		time = msg_sched.now + 1;
+	}
+
+	slot->due = time;
+	slot->id = id;
+	slot->length = bufferLength;
+
+	for (uint8_t i = 0; i < bufferLength; i++) {
+		slot->message[i] = buffer[i];
+	}
+
+	msg_sched.ids[id] = index;
+	msg_sched.pending++;
+	msg_sched_link(index);
+
+	return true;
+}
+
+bool msg_sched_after(uint8_t id, uint32_t delay, uint8_t bufferLength, const uint8_t* buffer) {
+	return msg_sched_at(id, msg_sched.now + delay, bufferLength, buffer);
+}
+
+bool msg_sched_cancel(uint8_t id) {
+	uint8_t index = msg_sched.ids[id];
+
+	if (index == MSG_SCHED_NO_SLOT) {
+		return false;
+	}
+
+	msg_sched_release(index);
+
+	return true;
+}
+
+size_t msg_sched_pending(void) {
+	return msg_sched.pending;
+}
+
+/// Moves all messages of the current bucket of a level to the lower levels.
+///
+/// @param level The level to cascade (`> 0`).
+void msg_sched_cascade(uint16_t level) {
+	uint32_t shift = level * MSG_SCHED_WHEEL_BITS;
+	uint16_t bucket = level * MSG_SCHED_WHEEL_SIZE + ((msg_sched.now >> shift) & MSG_SCHED_WHEEL_MASK);
+	uint8_t index = msg_sched.buckets[bucket];
+
+	msg_sched.buckets[bucket] = MSG_SCHED_NO_SLOT;
+
+	while (index != MSG_SCHED_NO_SLOT) {
+		uint8_t next = msg_sched_slot(index)->next;
+
+		msg_sched.level_pending[level]--;
+		msg_sched_link(index);
+		index = next;
+	}
+}
+
+/// Processes all messages of the current bucket of the first level (all due
+/// at the current tick).
+///
+/// @param result The statistics to update.
+void msg_sched_fire(MsgSchedAdvanceResult* result) {
+	uint8_t* head = &msg_sched.buckets[msg_sched.now & MSG_SCHED_WHEEL_MASK];
+
+	// The slot is released before the message is processed, so the message
+	// may schedule or cancel messages itself.
+	while (*head != MSG_SCHED_NO_SLOT) {
+		MsgSchedSlot* slot = msg_sched_slot(*head);
+		uint8_t message[MSG_FRAME_MAX_LENGTH];
+		uint8_t length = slot->length;
+
+		for (uint8_t i = 0; i < length; i++) {
+			message[i] = slot->message[i];
+		}
+
+		msg_sched_release(*head);
+
+		int status = process_message(length, message);
+
+		result->messages++;
+
+		if (status != 0) {
+			result->errors++;
+			result->last_error = status;
+		}
+	}
+}
+
+size_t msg_sched_advance(uint32_t now, MsgSchedAdvanceResult* result) {
+	MsgSchedAdvanceResult local = { 0 };
+
+	// Time must not go backwards.
+	if ((int32_t)(now - msg_sched.now) <= 0) {
+		if (result != NULL) {
+			*result = local;
+		}
+
+		return 0;
+	}
+
+	led_begin();
+
+	while (msg_sched.pending > 0) {
+		// Skip ticks without work: with the lower levels empty, the next
+		// event is the next cascade of the lowest non empty level.
+		uint32_t level = 0;
+
+		while (msg_sched.level_pending[level] == 0) {
+			level++;
+		}
+
+		uint32_t step = (uint32_t)1 << (level * MSG_SCHED_WHEEL_BITS);
+		uint32_t tick = (msg_sched.now | (step - 1)) + 1;
+
+		if ((int32_t)(tick - now) > 0) {
+			break;
+		}
+
+		msg_sched.now = tick;
+
+		// Cascade every level whose bucket index wrapped, highest first.
+		uint16_t levels = 1;
+
+		while (levels < MSG_SCHED_WHEEL_LEVELS && (tick & ((1u << (levels * MSG_SCHED_WHEEL_BITS)) - 1)) == 0) {
+			levels++;
+		}
+
+		for (uint16_t cascade = levels - 1; cascade > 0; cascade--) {
+			msg_sched_cascade(cascade);
+		}
+
+		msg_sched_fire(&local);
+	}
+
+	msg_sched.now = now;
+
+	led_commit();
+
+	if (result != NULL) {
+		*result = local;
+	}
+
+	return local.messages;
+}
@@ -0,0 +1,117 @@
+//! \file msg_sched.h
+//!
+//! Scheduler for deferred messages (e.g. "turn the led off in 500 ticks").
+//!
+//! Scheduled messages are kept in a hierarchical timer wheel of
+//! #MSG_SCHED_WHEEL_LEVELS levels with #MSG_SCHED_WHEEL_SIZE buckets each. Level `n`
+//! has a resolution of `MSG_SCHED_WHEEL_SIZE^n` ticks; messages move to the lower
+//! levels while their due time approaches. Inserting and cancelling a message
+//! is O(1).
+//!
+//! Time is measured in ticks of the caller (e.g. milliseconds), usually the
+//! same ticks as passed to led_tick().
+//!
+//! ```c
+//! msg_sched_init(now); // during startup
+//!
+//! void main_loop(void) {
+//!     for (;;) {
+//!         uint32_t now = millis();
+//!
+//!         msg_sched_advance(now, NULL);
+//!         led_tick(now);
+//!     }
+//! }
+//! ```
+//!
+//! # NOTE
+//! All messages are held in a pool of #MSG_SCHED_CAPACITY preallocated slots, the
+//! scheduler never allocates. Each message is identified by an id chosen by the
+//! caller; scheduling an id which is already pending replaces its message.
+
+#ifndef _MSG_SCHED_H_
+#define _MSG_SCHED_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "msg.h"
+
+/// Number of messages which can be pending at the same time (at most `255`).
+#ifndef MSG_SCHED_CAPACITY
+#define MSG_SCHED_CAPACITY 64
+#endif
+
+/// Bits of the due time covered by each level of the wheel.
+#define MSG_SCHED_WHEEL_BITS 6
+/// Number of buckets of each level of the wheel.
+#define MSG_SCHED_WHEEL_SIZE (1 << MSG_SCHED_WHEEL_BITS)
+/// Number of levels of the wheel.
+///
+/// Messages due after more than `2^(MSG_SCHED_WHEEL_BITS * MSG_SCHED_WHEEL_LEVELS)`
+/// ticks are parked in the last level until they are in range.
+#define MSG_SCHED_WHEEL_LEVELS 4
+
+/// Statistics of a single msg_sched_advance() call.
+typedef struct {
+	/// Number of messages which where processed (successfully or not).
+	size_t messages;
+	/// Number of messages which failed to process.
+	size_t errors;
+	/// The last error which occurred (`0` if none occurred).
+	int last_error;
+} MsgSchedAdvanceResult;
+
+/// Initializes (or resets) the scheduler, dropping all pending messages.
+///
+/// @param now The current time in ticks.
+void msg_sched_init(uint32_t now);
+
+/// Schedules a message to be processed `delay` ticks after the current time
+/// (the time of the last msg_sched_advance()).
+///
+/// @param id The id of the message (replaces a pending message with the same id).
+/// @param delay The delay in ticks (`0` processes the message on the next tick).
+/// @param bufferLength The length of the message in buffer.
+/// @param buffer The buffer which holds the message.
+///
+/// @return `true` if the message was scheduled, `false` if it is too long or no slot is free.
+bool msg_sched_after(uint8_t id, uint32_t delay, uint8_t bufferLength, const uint8_t* buffer);
+
+/// Schedules a message to be processed at the tick `time`.
+///
+/// Times which already passed are processed on the next tick.
+///
+/// @param id The id of the message (replaces a pending message with the same id).
+/// @param time The tick to process the message at.
+/// @param bufferLength The length of the message in buffer.
+/// @param buffer The buffer which holds the message.
+///
+/// @return `true` if the message was scheduled, `false` if it is too long or no slot is free.
+bool msg_sched_at(uint8_t id, uint32_t time, uint8_t bufferLength, const uint8_t* buffer);
+
+/// Cancels a pending message.
+///
+/// @param id The id of the message.
+///
+/// @return `true` if the message was pending, `false` otherwise.
+bool msg_sched_cancel(uint8_t id);
+
+/// Returns the number of pending messages.
+size_t msg_sched_pending(void);
+
+/// Advances the scheduler to `now` and processes all messages which are due
+/// with process_message().
+///
+/// All messages of a call are applied inside a single led transaction (see
+/// led_begin()), so an advance results in at most one write of the led
+/// register.
+///
+/// @param now The current time in ticks (may wrap around, must not go backwards).
+/// @param result Optional (may be `NULL`), receives the statistics of this call.
+///
+/// @return The number of messages which where processed (successfully or not).
+size_t msg_sched_advance(uint32_t now, MsgSchedAdvanceResult* result);
+
+#endif
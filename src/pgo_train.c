@@ -0,0 +1,136 @@
+//! \file pgo_train.c
+//!
+//! Training workload for the profile guided optimized library (see
+//! `make build-lib-pgo`).
+//!
+//! Runs against the instrumented library and drives the message paths with
+//! representative traffic, so the recorded profile matches the way the
+//! library is used:
+//!
+//! - single messages with process_message() (e.g. replay.c),
+//! - byte streams in transactions with msg_stream_process_results() (e.g.
+//!   server.c),
+//! - batches with process_messages().
+//!
+//! The traffic is mostly settings, some on/off and a few unknown op codes (the
+//! mix of loadgen.c, #WORKLOAD_MIX_SERVER of workload.h).
+//!
+//! ```sh
+//! ./pgo_train [messages]
+//! ```
+//!
+//! `messages` is the number of messages per path (default `1000000`).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "led.h"
+#include "led_bank.h"
+#include "msg.h"
+#include "workload.h"
+
+/// Number of generated messages (reused round robin).
+#define TRAIN_POOL 65536
+/// Number of bytes passed to msg_stream_process_results() at once.
+#define TRAIN_STREAM_CHUNK 4096
+/// Number of messages per process_messages() call.
+#define TRAIN_BATCH 256
+
+/// The generated messages back-to-back.
+uint8_t train_buffer[TRAIN_POOL * WORKLOAD_MAX_LENGTH];
+/// Location of each generated message in `train_buffer`.
+MsgBatchEntry train_entries[TRAIN_POOL];
+/// Number of used bytes in `train_buffer`.
+size_t train_length;
+
+/// Generates the message pool.
+void train_generate(void) {
+	uint32_t state = 0x9e3779b9;
+
+	for (size_t i = 0; i < TRAIN_POOL; i++) {
+		uint8_t length = workload_message(&state, WORKLOAD_MIX_SERVER, &train_buffer[train_length], NULL);
+
+		train_entries[i] = (MsgBatchEntry){ .offset = (uint32_t)train_length, .length = length };
+		train_length += length;
+	}
+}
+
+/// Processes `messages` single messages.
+///
+/// @return The number of failed messages.
+size_t train_single(size_t messages) {
+	size_t errors = 0;
+
+	for (size_t i = 0; i < messages; i++) {
+		const MsgBatchEntry* entry = &train_entries[i % TRAIN_POOL];
+
+		errors += process_message(entry->length, &train_buffer[entry->offset]) != 0;
+	}
+
+	return errors;
+}
+
+/// Processes the pool as byte stream until at least `messages` messages where
+/// processed. Every chunk is processed in a single transaction.
+///
+/// @return The number of failed messages.
+size_t train_stream(size_t messages) {
+	static uint8_t results[TRAIN_STREAM_CHUNK + 1];
+	MsgStream stream;
+	MsgStreamResult result;
+	size_t processed = 0;
+	size_t errors = 0;
+	size_t offset = 0;
+
+	msg_stream_init(&stream);
+
+	while (processed < messages) {
+		size_t length = train_length - offset < TRAIN_STREAM_CHUNK ? train_length - offset : TRAIN_STREAM_CHUNK;
+
+		led_begin();
+		processed += msg_stream_process_results(&stream, length, &train_buffer[offset], results, &result);
+		led_commit();
+
+		errors += result.errors;
+		offset = offset + length == train_length ? 0 : offset + length;
+	}
+
+	return errors;
+}
+
+/// Processes the pool in batches of #TRAIN_BATCH messages until at least
+/// `messages` messages where processed.
+///
+/// @return The number of failed messages.
+size_t train_batch(size_t messages) {
+	static uint8_t successes[TRAIN_BATCH / 8];
+	static MsgBatchError failed[TRAIN_BATCH];
+	size_t errors = 0;
+
+	for (size_t i = 0; i < messages; i += TRAIN_BATCH) {
+		errors += process_messages(train_buffer, &train_entries[i % TRAIN_POOL], TRAIN_BATCH, successes, failed, TRAIN_BATCH);
+	}
+
+	return errors;
+}
+
+int main(int argc, char** argv) {
+	size_t messages = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+
+	_Static_assert(TRAIN_POOL % TRAIN_BATCH == 0, "Batches must not cross the end of the pool");
+
+	led_init();
+	led_bank_init();
+	train_generate();
+
+	printf("path,messages,errors\n");
+	printf("single,%zu,%zu\n", messages, train_single(messages));
+	printf("stream,%zu,%zu\n", messages, train_stream(messages));
+	printf("batch,%zu,%zu\n", messages, train_batch(messages));
+
+	return 0;
+}
@@ -1,3 +1,62 @@
+//! \file registers.c
+//! Implementation for the led registers.
+//!
+//! See registers.h for the available functions and documentation.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
 #include "registers.h"
 
-uint8_t LED;
+/// The registers in process memory.
+Registers registers_memory = {
+	.magic     = REGISTERS_MAGIC,
+	.version   = REGISTERS_VERSION,
+	.bank_size = LED_BANK_SIZE,
+};
+
+Registers* registers_active = &registers_memory;
+
+void registers_use(Registers* block) {
+	registers_active = block != NULL ? block : &registers_memory;
+}
+
+void registers_header_init(Registers* block) {
+	block->magic     = REGISTERS_MAGIC;
+	block->version   = REGISTERS_VERSION;
+	block->bank_size = LED_BANK_SIZE;
+	atomic_store(&block->sequence, 0);
+}
+
+bool registers_header_valid(const Registers* block) {
+	return block->magic == REGISTERS_MAGIC
+		&& block->version == REGISTERS_VERSION
+		&& block->bank_size == LED_BANK_SIZE;
+}
+
+bool registers_snapshot(const Registers* block, RegistersSnapshot* snapshot) {
+	for (uint32_t attempt = 0; attempt < REGISTERS_SNAPSHOT_ATTEMPTS; attempt++) {
+		uint32_t begin = atomic_load_explicit(&block->sequence, memory_order_acquire);
+
+		// A write is in progress.
+		if (begin & 0x1) {
+			continue;
+		}
+
+		snapshot->led = block->led;
+		memcpy(snapshot->bank, block->bank, LED_BANK_SIZE);
+
+		// The copy must be complete before the counter is checked again.
+		atomic_thread_fence(memory_order_acquire);
+
+		if (atomic_load_explicit(&block->sequence, memory_order_relaxed) == begin) {
+			snapshot->sequence = begin;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -1,8 +1,135 @@
+//! \file registers.h
+//!
+//! The led registers (#LED and the led bank #LED_BANK).
+//!
+//! The registers live in a #Registers block. By default this is a block in
+//! process memory, registers_use() places them somewhere else, e.g. in a
+//! shared memory region which other processes map (see registers_shm.h).
+//! #LED and #LED_BANK always refer to the registers in use.
+//!
+//! Every write of the led (led_register_write()) and of the led bank is
+//! enclosed in registers_write_begin() and registers_write_end(), which make
+//! the sequence counter of the block odd while the write is in progress
+//! (seqlock). Readers take consistent copies with registers_snapshot():
+//!
+//! ```c
+//! RegistersSnapshot snapshot;
+//!
+//! if (registers_snapshot(registers_active, &snapshot)) {
+//!     show(snapshot.led, snapshot.bank);
+//! }
+//! ```
+//!
+//! # NOTE
+//! #LED is a macro, not an object (as in earlier versions), it can not be
+//! declared `extern` or used in constant initializers. Every write pays for
+//! the sequence counter, also if no shared region is used.
+//!
+//! The sequence counter supports a single writer of the led bank at a time.
+//! Writes with led_atomic.h are not counted, a single register is always
+//! consistent on its own.
+
 #ifndef _REGISTERS_H_
 #define _REGISTERS_H_
 
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdint.h>
 
-extern uint8_t LED;
+// Number of led registers in the led bank.
+// Can be overridden at compile time (e.g. `-DLED_BANK_SIZE=1024`).
+#ifndef LED_BANK_SIZE
+#define LED_BANK_SIZE 4096
+#endif
+
+/// Magic of a #Registers block (`LREG`, little endian).
+#define REGISTERS_MAGIC 0x4745524cu
+
+/// Version of the #Registers layout.
+#define REGISTERS_VERSION 1
+
+/// Number of attempts of registers_snapshot() before it gives up.
+#define REGISTERS_SNAPSHOT_ATTEMPTS 65536
+
+/// Block of all led registers.
+///
+/// This is also the layout of a shared register region.
+typedef struct {
+	/// #REGISTERS_MAGIC
+	uint32_t magic;
+	/// #REGISTERS_VERSION
+	uint32_t version;
+	/// Number of registers in `bank` (#LED_BANK_SIZE).
+	uint32_t bank_size;
+	/// Sequence counter, odd while a write is in progress.
+	_Atomic uint32_t sequence;
+	/// The led register.
+	uint8_t led;
+	/// The registers of the led bank.
+	uint8_t bank[LED_BANK_SIZE];
+} Registers;
+
+/// Consistent copy of a #Registers block.
+typedef struct {
+	/// Sequence counter of the copied state.
+	uint32_t sequence;
+	/// The led register.
+	uint8_t led;
+	/// The registers of the led bank.
+	uint8_t bank[LED_BANK_SIZE];
+} RegistersSnapshot;
+
+/// The registers in use.
+extern Registers* registers_active;
+
+/// The led register.
+#define LED (registers_active->led)
+
+/// The registers of the led bank (#LED_BANK_SIZE).
+#define LED_BANK (registers_active->bank)
+
+/// Places the registers in another block.
+///
+/// The block is used as is (values are not copied). Must not be called while
+/// any other thread uses the registers.
+///
+/// @param block The registers to use, `NULL` for the block in process memory.
+void registers_use(Registers* block);
+
+/// Initializes the header of a block (magic, version, bank size and sequence).
+///
+/// @param block The block.
+void registers_header_init(Registers* block);
+
+/// Returns if the header of a block matches this build.
+///
+/// @param block The block.
+///
+/// @return `true` if magic, version and bank size match, `false` otherwise.
+bool registers_header_valid(const Registers* block);
+
+/// Takes a consistent copy of a block.
+///
+/// @param block The block (e.g. mapped from another process).
+/// @param snapshot Receives the copy.
+///
+/// @return `true` on success, `false` if the block was written during all #REGISTERS_SNAPSHOT_ATTEMPTS attempts.
+bool registers_snapshot(const Registers* block, RegistersSnapshot* snapshot);
+
+/// Marks the start of a write to the registers in use.
+static inline void registers_write_begin(void) {
+	uint32_t sequence = atomic_load_explicit(&registers_active->sequence, memory_order_relaxed);
+
+	atomic_store_explicit(&registers_active->sequence, sequence + 1, memory_order_relaxed);
+	// The odd counter must be visible before any of the written registers.
+	atomic_thread_fence(memory_order_release);
+}
+
+/// Marks the end of a write started with registers_write_begin().
+static inline void registers_write_end(void) {
+	uint32_t sequence = atomic_load_explicit(&registers_active->sequence, memory_order_relaxed);
+
+	atomic_store_explicit(&registers_active->sequence, sequence + 1, memory_order_release);
+}
 
 #endif
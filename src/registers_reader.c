@@ -0,0 +1,96 @@
+//! \file registers_reader.c
+//!
+//! Shows the registers of a driver which placed them in a shared region (see
+//! registers_shm.h).
+//!
+//! The region is mapped read only, every line shows a consistent snapshot
+//! (see registers_snapshot()) of the led register and a summary of the led
+//! bank:
+//!
+//! ```sh
+//! ./registers_reader (shm|file) <name> [count] [interval_ms]
+//! ```
+//!
+//! `count` snapshots (default `1`, `0` for endless) are taken every
+//! `interval_ms` milliseconds (default `100`).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "led.h"
+#include "registers.h"
+#include "registers_shm.h"
+
+/// Number of bank registers which are shown in full.
+#define READER_BANK_PREVIEW 16
+
+/// Prints a snapshot as a single line.
+///
+/// @param snapshot The snapshot.
+void reader_print(const RegistersSnapshot* snapshot) {
+	size_t on = 0;
+
+	for (size_t i = 0; i < LED_BANK_SIZE; i++) {
+		on += (snapshot->bank[i] >> LED_STATE_OFFSET) & LED_STATE_VALUE_MASK;
+	}
+
+	printf("sequence=%u led=0x%02x state=%u color=%u brightness=%u bank_on=%zu/%d bank=",
+		(unsigned)snapshot->sequence,
+		snapshot->led,
+		(snapshot->led >> LED_STATE_OFFSET) & LED_STATE_VALUE_MASK,
+		(snapshot->led >> LED_COLOR_OFFSET) & LED_COLOR_VALUE_MASK,
+		(snapshot->led >> LED_BRIGHTNESS_OFFSET) & LED_BRIGHTNESS_VALUE_MASK,
+		on,
+		LED_BANK_SIZE);
+
+	for (size_t i = 0; i < READER_BANK_PREVIEW && i < LED_BANK_SIZE; i++) {
+		printf("%02x", snapshot->bank[i]);
+	}
+
+	printf("\n");
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3 || (strcmp(argv[1], "shm") != 0 && strcmp(argv[1], "file") != 0)) {
+		fprintf(stderr, "Usage: %s (shm|file) <name> [count] [interval_ms]\n", argv[0]);
+		return 2;
+	}
+
+	RegistersShmKind kind = strcmp(argv[1], "shm") == 0 ? REGISTERS_SHM_OBJECT : REGISTERS_SHM_FILE;
+	unsigned long count = argc > 3 ? strtoul(argv[3], NULL, 10) : 1;
+	unsigned long interval = argc > 4 ? strtoul(argv[4], NULL, 10) : 100;
+
+	const Registers* shared = registers_shm_attach(kind, argv[2]);
+
+	if (shared == NULL) {
+		fprintf(stderr, "%s: Missing region or invalid header\n", argv[2]);
+		return 1;
+	}
+
+	static RegistersSnapshot snapshot;
+	struct timespec delay = { (time_t)(interval / 1000), (long)(interval % 1000) * 1000000 };
+
+	for (unsigned long i = 0; count == 0 || i < count; i++) {
+		if (i > 0) {
+			nanosleep(&delay, NULL);
+		}
+
+		if (!registers_snapshot(shared, &snapshot)) {
+			fprintf(stderr, "No consistent snapshot (writer busy or stopped during a write)\n");
+			continue;
+		}
+
+		reader_print(&snapshot);
+		fflush(stdout);
+	}
+
+	registers_shm_detach(shared);
+
+	return 0;
+}
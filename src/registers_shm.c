@@ -0,0 +1,147 @@
+//! \file registers_shm.c
+//! Implementation for the shared register backend.
+//!
+//! See registers_shm.h for the available functions and documentation.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "registers.h"
+#include "registers_shm.h"
+
+/// The mapped region (`NULL` if the registers are in process memory).
+Registers* registers_shm_region;
+
+/// Opens a shared region.
+///
+/// @param kind The kind of the region.
+/// @param name The name of the shared memory object or the path of the file.
+/// @param writable `true` to open (or create) the region for writing.
+///
+/// @return The file descriptor or `-1` on error.
+int registers_shm_open(RegistersShmKind kind, const char* name, bool writable) {
+	int flags = writable ? O_RDWR | O_CREAT : O_RDONLY;
+
+	switch (kind) {
+		case REGISTERS_SHM_OBJECT:
+			return shm_open(name, flags, 0644);
+		case REGISTERS_SHM_FILE:
+			return open(name, flags, 0644);
+		default:
+			return -1;
+	}
+}
+
+bool registers_shm_map(RegistersShmKind kind, const char* name) {
+	int fd = registers_shm_open(kind, name, true);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || ((size_t)st.st_size < sizeof(Registers) && ftruncate(fd, sizeof(Registers)) != 0)) {
+		close(fd);
+		return false;
+	}
+
+	void* data = mmap(NULL, sizeof(Registers), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	Registers* region = data;
+
+	// Readers of an existing region continue with its sequence counter. An odd
+	// counter is left by a writer which stopped during a write, it is rounded
+	// up so the next write starts from an even value again.
+	if (!registers_header_valid(region)) {
+		registers_header_init(region);
+	} else {
+		uint32_t sequence = atomic_load_explicit(&region->sequence, memory_order_relaxed);
+
+		if (sequence & 0x1) {
+			atomic_store_explicit(&region->sequence, sequence + 1, memory_order_release);
+		}
+	}
+
+	Registers* previous = registers_active;
+
+	registers_use(region);
+
+	registers_write_begin();
+	region->led = previous->led;
+	memcpy(region->bank, previous->bank, LED_BANK_SIZE);
+	registers_write_end();
+
+	if (registers_shm_region != NULL) {
+		munmap(registers_shm_region, sizeof(Registers));
+	}
+
+	registers_shm_region = region;
+
+	return true;
+}
+
+void registers_shm_unmap(void) {
+	if (registers_shm_region == NULL) {
+		return;
+	}
+
+	registers_use(NULL);
+
+	registers_write_begin();
+	LED = registers_shm_region->led;
+	memcpy(LED_BANK, registers_shm_region->bank, LED_BANK_SIZE);
+	registers_write_end();
+
+	munmap(registers_shm_region, sizeof(Registers));
+	registers_shm_region = NULL;
+}
+
+const Registers* registers_shm_attach(RegistersShmKind kind, const char* name) {
+	int fd = registers_shm_open(kind, name, false);
+
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Registers)) {
+		close(fd);
+		return NULL;
+	}
+
+	void* data = mmap(NULL, sizeof(Registers), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+
+	if (!registers_header_valid(data)) {
+		munmap(data, sizeof(Registers));
+		return NULL;
+	}
+
+	return data;
+}
+
+void registers_shm_detach(const Registers* block) {
+	if (block != NULL) {
+		munmap((void*)block, sizeof(Registers));
+	}
+}
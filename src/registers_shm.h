@@ -0,0 +1,76 @@
+//! \file registers_shm.h
+//!
+//! Shared register backend.
+//!
+//! Places the led registers (see registers.h) in a POSIX shared memory
+//! object or a memory mapped file, so other processes (simulators, monitors)
+//! can observe them live. The registers are written in place, there are no
+//! copies or system calls on the write path:
+//!
+//! ```c
+//! // Driver (during startup, before any other thread uses the registers)
+//! registers_shm_map(REGISTERS_SHM_OBJECT, "/led_registers");
+//!
+//! // Other process
+//! const Registers* shared = registers_shm_attach(REGISTERS_SHM_OBJECT, "/led_registers");
+//! RegistersSnapshot snapshot;
+//!
+//! if (shared != NULL && registers_snapshot(shared, &snapshot)) {
+//!     show(snapshot.led, snapshot.bank);
+//! }
+//! ```
+//!
+//! The region holds a single #Registers block, readers check its header with
+//! registers_header_valid().
+//!
+//! # NOTE
+//! Only POSIX systems are supported.
+
+#ifndef _REGISTERS_SHM_H_
+#define _REGISTERS_SHM_H_
+
+#include <stdbool.h>
+
+#include "registers.h"
+
+/// Kinds of shared regions.
+typedef enum {
+	/// POSIX shared memory object (see `shm_open()`), e.g. `"/led_registers"`.
+	REGISTERS_SHM_OBJECT = 0,
+	/// Memory mapped regular file.
+	REGISTERS_SHM_FILE,
+} RegistersShmKind;
+
+/// Places the registers in a shared region.
+///
+/// The region is created (or resized) if needed. The current values of the
+/// registers are copied into it. An existing region keeps its sequence
+/// counter (rounded up to even if a previous writer stopped during a write).
+/// Must not be called while any other thread uses the registers.
+///
+/// @param kind The kind of the region.
+/// @param name The name of the shared memory object or the path of the file.
+///
+/// @return `true` on success, `false` if the region could not be mapped (the registers are unchanged).
+bool registers_shm_map(RegistersShmKind kind, const char* name);
+
+/// Moves the registers back into process memory.
+///
+/// The current values of the registers are copied back. The region itself
+/// stays in place (remove it with `shm_unlink()` or `remove()`).
+void registers_shm_unmap(void);
+
+/// Maps a shared region for reading (e.g. from another process).
+///
+/// @param kind The kind of the region.
+/// @param name The name of the shared memory object or the path of the file.
+///
+/// @return The registers or `NULL` if the region could not be mapped or its header is invalid.
+const Registers* registers_shm_attach(RegistersShmKind kind, const char* name);
+
+/// Unmaps a region mapped with registers_shm_attach().
+///
+/// @param block The registers.
+void registers_shm_detach(const Registers* block);
+
+#endif
@@ -0,0 +1,361 @@
+//! \file replay.c
+//!
+//! Replays captured message traffic through process_message().
+//!
+//! The capture is memory mapped and every message is processed directly from
+//! the mapping (no copies). The return code of every message and the final
+//! led register are verified against an expected results file. The throughput
+//! (messages per second) is reported, so the tool doubles as a macro
+//! benchmark.
+//!
+//! ```sh
+//! ./replay run <capture> [expected]
+//! ./replay generate <capture> <expected> <count> [seed]
+//! ```
+//!
+//! `generate` creates a synthetic capture (mostly settings, some on/off and a
+//! few invalid messages, #WORKLOAD_MIX_MIXED of workload.h) together with its
+//! expected results, calculated by a reference model independent of the
+//! library.
+//!
+//! # Capture format
+//!
+//! All values are little endian.
+//!
+//! | Offset | Size | Description                        |
+//! | ------ | ---- | ---------------------------------- |
+//! | `0`    | `4`  | Magic `LCAP`                       |
+//! | `4`    | `4`  | Number of messages                 |
+//! | `8`    |      | Messages                           |
+//!
+//! Message: length (`1` byte) followed by the message itself (`length` bytes).
+//!
+//! # Expected results format
+//!
+//! | Offset | Size | Description                                  |
+//! | ------ | ---- | -------------------------------------------- |
+//! | `0`    | `4`  | Magic `LEXP`                                 |
+//! | `4`    | `4`  | Number of messages                           |
+//! | `8`    | `1`  | Final value of the led register              |
+//! | `9`    |      | Result of process_message() per message (`1` byte each) |
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "led.h"
+#include "msg.h"
+#include "registers.h"
+#include "workload.h"
+
+/// Size of the capture header.
+#define REPLAY_CAPTURE_HEADER_SIZE 8
+/// Size of the expected results header.
+#define REPLAY_EXPECTED_HEADER_SIZE 9
+
+/// A read only memory mapped file.
+typedef struct {
+	/// Start of the mapping.
+	const uint8_t* data;
+	/// Size of the file.
+	size_t size;
+} ReplayMapping;
+
+/// Reads a little endian `uint32_t` from `buffer`.
+uint32_t replay_get_u32(const uint8_t* buffer) {
+	return (uint32_t)buffer[0] | (uint32_t)buffer[1] << 8 | (uint32_t)buffer[2] << 16 | (uint32_t)buffer[3] << 24;
+}
+
+/// Writes `value` as little endian `uint32_t` into `buffer`.
+void replay_put_u32(uint8_t* buffer, uint32_t value) {
+	for (size_t i = 0; i < 4; i++) {
+		buffer[i] = (uint8_t)(value >> (8 * i));
+	}
+}
+
+/// Maps a file read only.
+///
+/// @param path The file to map.
+/// @param mapping Receives the mapping.
+///
+/// @return `0` on success, `-1` otherwise.
+int replay_map(const char* path, ReplayMapping* mapping) {
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		fprintf(stderr, "%s: Empty or unreadable file\n", path);
+		close(fd);
+		return -1;
+	}
+
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		perror(path);
+		return -1;
+	}
+
+	// The capture is read front to back exactly once.
+	posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+	mapping->data = data;
+	mapping->size = (size_t)st.st_size;
+
+	return 0;
+}
+
+/// Unmaps a file mapped with replay_map().
+void replay_unmap(ReplayMapping* mapping) {
+	munmap((void*)mapping->data, mapping->size);
+}
+
+/*
+ * Run
+ */
+
+/// Replays a capture and verifies the results.
+///
+/// @param capture_path Path of the capture.
+/// @param expected_path Path of the expected results (may be `NULL`).
+///
+/// @return `0` if the capture could be replayed and all results matched, `1` otherwise.
+int replay_run(const char* capture_path, const char* expected_path) {
+	ReplayMapping capture;
+	ReplayMapping expected = { NULL, 0 };
+
+	if (replay_map(capture_path, &capture) != 0) {
+		return 1;
+	}
+
+	if (capture.size < REPLAY_CAPTURE_HEADER_SIZE || memcmp(capture.data, "LCAP", 4) != 0) {
+		fprintf(stderr, "%s: Not a capture\n", capture_path);
+		replay_unmap(&capture);
+		return 1;
+	}
+
+	uint32_t count = replay_get_u32(&capture.data[4]);
+
+	if (expected_path != NULL) {
+		if (replay_map(expected_path, &expected) != 0) {
+			replay_unmap(&capture);
+			return 1;
+		}
+
+		if (expected.size != REPLAY_EXPECTED_HEADER_SIZE + (size_t)count
+				|| memcmp(expected.data, "LEXP", 4) != 0
+				|| replay_get_u32(&expected.data[4]) != count) {
+			fprintf(stderr, "%s: Does not match the capture\n", expected_path);
+			replay_unmap(&expected);
+			replay_unmap(&capture);
+			return 1;
+		}
+	}
+
+	// Only verified if an expected results file was given.
+	const uint8_t* results = expected.data != NULL ? &expected.data[REPLAY_EXPECTED_HEADER_SIZE] : NULL;
+
+	led_init();
+
+	const uint8_t* cursor = &capture.data[REPLAY_CAPTURE_HEADER_SIZE];
+	const uint8_t* end    = capture.data + capture.size;
+	size_t processed  = 0;
+	size_t errors     = 0;
+	size_t mismatches = 0;
+
+	uint64_t start = workload_now_ns();
+
+	while (processed < count && cursor < end && (size_t)(end - cursor) > *cursor) {
+		uint8_t length = *cursor;
+		int status = process_message(length, cursor + 1);
+
+		errors += status != 0;
+
+		if (results != NULL && status != results[processed]) {
+			if (mismatches < 10) {
+				fprintf(stderr, "Message %zu: Result %d, expected %d\n", processed, status, results[processed]);
+			}
+
+			mismatches++;
+		}
+
+		cursor += 1 + length;
+		processed++;
+	}
+
+	uint64_t elapsed = workload_now_ns() - start;
+
+	int status = 0;
+
+	if (processed != count) {
+		fprintf(stderr, "%s: Truncated capture (%zu of %u messages)\n", capture_path, processed, count);
+		status = 1;
+	}
+
+	if (results != NULL && LED != expected.data[8]) {
+		fprintf(stderr, "Final led register 0x%02x, expected 0x%02x\n", LED, expected.data[8]);
+		status = 1;
+	}
+
+	if (mismatches > 0) {
+		fprintf(stderr, "%zu result mismatches\n", mismatches);
+		status = 1;
+	}
+
+	double seconds = (double)elapsed / 1e9;
+
+	printf("messages: %zu\n", processed);
+	printf("errors: %zu\n", errors);
+	printf("bytes: %zu\n", (size_t)(cursor - capture.data));
+	printf("seconds: %.6f\n", seconds);
+	printf("messages_per_second: %.0f\n", seconds > 0.0 ? (double)processed / seconds : 0.0);
+	printf("ns_per_message: %.3f\n", processed > 0 ? (double)elapsed / (double)processed : 0.0);
+	printf("verified: %s\n", results == NULL ? "no" : status == 0 ? "ok" : "failed");
+
+	if (expected.data != NULL) {
+		replay_unmap(&expected);
+	}
+
+	replay_unmap(&capture);
+
+	return status;
+}
+
+/*
+ * Generate
+ */
+
+/// Reference model of process_message() for the generated messages.
+///
+/// @param led The led register of the model.
+/// @param length The length of the message.
+/// @param message The message.
+///
+/// @return The expected result of process_message().
+int replay_model(uint8_t* led, uint8_t length, const uint8_t* message) {
+	switch (message[0]) {
+		case MSG_OP_CODE_ON:
+		case MSG_OP_CODE_OFF:
+			if (length != 1) {
+				return MSG_ERROR_CODE_TRAILING_BYTES;
+			}
+
+			*led = (*led & ~LED_STATE_MASK) | (message[0] == MSG_OP_CODE_ON) << LED_STATE_OFFSET;
+			return 0;
+		case MSG_OP_CODE_LED_SETTINGS:
+			if (length < 3) {
+				return MSG_ERROR_CODE_MISSING_PARAMETERS;
+			} else if (length > 3) {
+				return MSG_ERROR_CODE_TRAILING_BYTES;
+			}
+
+			*led = (*led & LED_STATE_MASK) | (message[1] & 0x7) << LED_COLOR_OFFSET | (message[2] & 0xf) << LED_BRIGHTNESS_OFFSET;
+			return 0;
+		default:
+			return MSG_ERROR_CODE_INVALID_OP_CODE;
+	}
+}
+
+/// Generates a synthetic capture and its expected results.
+///
+/// @return `0` on success, `1` otherwise.
+int replay_generate(const char* capture_path, const char* expected_path, uint32_t count, uint32_t seed) {
+	FILE* capture  = fopen(capture_path, "wb");
+	FILE* expected = fopen(expected_path, "wb");
+
+	if (capture == NULL || expected == NULL) {
+		perror("generate");
+
+		if (capture != NULL) {
+			fclose(capture);
+		}
+
+		if (expected != NULL) {
+			fclose(expected);
+		}
+
+		return 1;
+	}
+
+	uint8_t header[REPLAY_EXPECTED_HEADER_SIZE] = { 'L', 'C', 'A', 'P' };
+	replay_put_u32(&header[4], count);
+	fwrite(header, REPLAY_CAPTURE_HEADER_SIZE, 1, capture);
+
+	// The final led value is only known at the end, the header is rewritten then.
+	memcpy(header, "LEXP", 4);
+	fwrite(header, REPLAY_EXPECTED_HEADER_SIZE, 1, expected);
+
+	uint32_t state = seed != 0 ? seed : 1;
+	uint8_t led = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint8_t record[1 + WORKLOAD_MAX_LENGTH];
+		uint8_t* message = &record[1];
+		uint8_t length = workload_message(&state, WORKLOAD_MIX_MIXED, message, NULL);
+
+		record[0] = length;
+		uint8_t result = (uint8_t)replay_model(&led, length, message);
+
+		fwrite(record, 1 + length, 1, capture);
+		fwrite(&result, 1, 1, expected);
+	}
+
+	header[8] = led;
+	fseek(expected, 0, SEEK_SET);
+	fwrite(header, REPLAY_EXPECTED_HEADER_SIZE, 1, expected);
+
+	int status = 0;
+
+	if (ferror(capture) || ferror(expected)) {
+		status = 1;
+	}
+
+	// Both files are closed (and flushed), even if closing the first one fails.
+	status |= fclose(capture) != 0;
+	status |= fclose(expected) != 0;
+
+	if (status != 0) {
+		fprintf(stderr, "generate: Failed to write the files\n");
+	}
+
+	return status;
+}
+
+/// Prints the usage of the tool.
+void replay_usage(const char* name) {
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "  %s run <capture> [expected]\n", name);
+	fprintf(stderr, "  %s generate <capture> <expected> <count> [seed]\n", name);
+}
+
+int main(int argc, char** argv) {
+	if (argc >= 3 && strcmp(argv[1], "run") == 0) {
+		return replay_run(argv[2], argc > 3 ? argv[3] : NULL);
+	}
+
+	if (argc >= 5 && strcmp(argv[1], "generate") == 0) {
+		uint32_t count = (uint32_t)strtoul(argv[4], NULL, 10);
+		uint32_t seed  = argc > 5 ? (uint32_t)strtoul(argv[5], NULL, 10) : 1;
+
+		return replay_generate(argv[2], argv[3], count, seed);
+	}
+
+	replay_usage(argv[0]);
+
+	return 2;
+}
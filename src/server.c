@@ -0,0 +1,417 @@
+//! \file server.c
+//!
+//! Reference daemon which receives messages over a Unix domain socket (a
+//! local stand-in for the serial link).
+//!
+//! A single thread serves all clients with epoll. Readable clients are read
+//! non-blocking into a large buffer, all complete messages of a read are
+//! decoded and processed directly from the buffer (see
+//! msg_stream_process_results()) and partial messages are kept per client.
+//! All messages received within one wake up (of all clients) are applied in
+//! a single led transaction, so they result in at most one register write.
+//!
+//! ```sh
+//! ./server [-r] [-s <snapshot>] <socket>
+//! ```
+//!
+//! With `-r` every processed message is answered with a single byte, its
+//! result (`0` or a variant of #MsgErrorCode), in the order the messages were
+//! received. While the replies of a client can not be sent, no further
+//! messages are read from it.
+//!
+//! With `-s` the leds are restored from the snapshot file during startup and
+//! a snapshot is written every #SERVER_SNAPSHOT_INTERVAL_MS milliseconds (if
+//! messages where processed) and on exit (see led_snapshot.h).
+//!
+//! The server runs until it receives `SIGINT` or `SIGTERM` and prints its
+//! statistics to standard error before it exits.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "led.h"
+#include "led_snapshot.h"
+#include "msg.h"
+
+/// Size of the receive buffer.
+#define SERVER_BUFFER_SIZE 65536
+/// Maximum number of events per wake up.
+#define SERVER_EVENTS 256
+/// Maximum number of reads from a single client per wake up (fairness).
+#define SERVER_READS_PER_EVENT 4
+/// Interval between two snapshots (see `-s`).
+#define SERVER_SNAPSHOT_INTERVAL_MS 1000
+
+/// State of a connected client.
+typedef struct {
+	/// The socket of the client.
+	int fd;
+	/// Partial message of the client.
+	MsgStream stream;
+	/// Replies which could not be sent yet (`NULL` if none).
+	uint8_t* out;
+	/// Number of bytes in `out`.
+	size_t out_length;
+	/// Number of bytes of `out` which where sent.
+	size_t out_sent;
+} ServerClient;
+
+/// Statistics of the server.
+typedef struct {
+	/// Number of accepted clients.
+	size_t clients;
+	/// Number of received bytes.
+	size_t bytes;
+	/// Number of processed messages.
+	size_t messages;
+	/// Number of messages which failed to process.
+	size_t errors;
+	/// Number of batches (wake ups which processed at least one message).
+	size_t batches;
+} ServerStats;
+
+/// Set by the signal handler to stop the server.
+volatile sig_atomic_t server_stop;
+
+/// Statistics of the server.
+ServerStats server_stats;
+
+/// The epoll instance.
+int server_epoll;
+
+/// Whether results are replied.
+bool server_reply;
+
+/// Receive buffer (shared by all clients).
+uint8_t server_buffer[SERVER_BUFFER_SIZE];
+
+/// Results of the messages of a single read.
+uint8_t server_results[SERVER_BUFFER_SIZE + 1];
+
+/// Stops the server.
+void server_signal(int number) {
+	(void)number;
+	server_stop = 1;
+}
+
+/// Makes a file descriptor non-blocking.
+///
+/// @return `0` on success, `-1` otherwise.
+int server_nonblocking(int fd) {
+	int flags = fcntl(fd, F_GETFL);
+
+	return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/// Disconnects a client.
+void server_close(ServerClient* client) {
+	close(client->fd);
+	free(client->out);
+	free(client);
+}
+
+/// Sends the pending replies of a client.
+///
+/// @return `0` if all replies were sent, `1` if some are left, `-1` on error.
+int server_flush(ServerClient* client) {
+	while (client->out_sent < client->out_length) {
+		ssize_t sent = write(client->fd, &client->out[client->out_sent], client->out_length - client->out_sent);
+
+		if (sent < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 1 : -1;
+		}
+
+		client->out_sent += (size_t)sent;
+	}
+
+	free(client->out);
+	client->out = NULL;
+	client->out_length = 0;
+	client->out_sent = 0;
+
+	return 0;
+}
+
+/// Sends replies to a client, replies which can not be sent immediately are
+/// kept and the client waits until they are sent.
+///
+/// @return `0` on success, `-1` if the client has to be closed.
+int server_send(ServerClient* client, const uint8_t* replies, size_t count) {
+	ssize_t sent = write(client->fd, replies, count);
+
+	if (sent < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			return -1;
+		}
+
+		sent = 0;
+	}
+
+	if ((size_t)sent == count) {
+		return 0;
+	}
+
+	client->out = malloc(count - (size_t)sent);
+
+	if (client->out == NULL) {
+		return -1;
+	}
+
+	memcpy(client->out, &replies[sent], count - (size_t)sent);
+	client->out_length = count - (size_t)sent;
+	client->out_sent = 0;
+
+	// Stop reading until the replies are sent.
+	struct epoll_event event = { .events = EPOLLOUT, .data.ptr = client };
+
+	return epoll_ctl(server_epoll, EPOLL_CTL_MOD, client->fd, &event);
+}
+
+/// Reads and processes the messages of a readable client.
+///
+/// @return `0` on success, `-1` if the client has to be closed.
+int server_receive(ServerClient* client) {
+	for (int i = 0; i < SERVER_READS_PER_EVENT; i++) {
+		ssize_t received = read(client->fd, server_buffer, sizeof(server_buffer));
+
+		if (received == 0) {
+			return -1;
+		}
+
+		if (received < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+		}
+
+		MsgStreamResult result;
+		size_t count = msg_stream_process_results(&client->stream, (size_t)received, server_buffer, server_results, &result);
+
+		server_stats.bytes    += (size_t)received;
+		server_stats.messages += count;
+		server_stats.errors   += result.errors;
+
+		if (server_reply && count > 0 && server_send(client, server_results, count) != 0) {
+			return -1;
+		}
+
+		// Less than a full buffer, the socket is drained (or waits for replies).
+		if ((size_t)received < sizeof(server_buffer) || client->out != NULL) {
+			return 0;
+		}
+	}
+
+	return 0;
+}
+
+/// Accepts all pending clients.
+void server_accept(int listener) {
+	for (;;) {
+		int fd = accept(listener, NULL, NULL);
+
+		if (fd < 0) {
+			return;
+		}
+
+		ServerClient* client = calloc(1, sizeof(ServerClient));
+
+		if (client == NULL || server_nonblocking(fd) != 0) {
+			free(client);
+			close(fd);
+			continue;
+		}
+
+		client->fd = fd;
+		msg_stream_init(&client->stream);
+
+		struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+
+		if (epoll_ctl(server_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+			server_close(client);
+			continue;
+		}
+
+		server_stats.clients++;
+	}
+}
+
+/// Creates the listening socket.
+///
+/// @return The socket or `-1` on error.
+int server_listen(const char* path) {
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "%s: Path too long\n", path);
+		return -1;
+	}
+
+	strcpy(address.sun_path, path);
+	unlink(path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0 || server_nonblocking(fd) != 0) {
+		perror(path);
+
+		if (fd >= 0) {
+			close(fd);
+		}
+
+		return -1;
+	}
+
+	return fd;
+}
+
+/// Returns the current time of a monotonic clock in milliseconds.
+uint64_t server_now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+int main(int argc, char** argv) {
+	const char* snapshot = NULL;
+	int arg = 1;
+
+	for (; arg < argc - 1; arg++) {
+		if (strcmp(argv[arg], "-r") == 0) {
+			server_reply = true;
+		} else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc - 1) {
+			snapshot = argv[++arg];
+		} else {
+			break;
+		}
+	}
+
+	if (arg != argc - 1) {
+		fprintf(stderr, "Usage: %s [-r] [-s <snapshot>] <socket>\n", argv[0]);
+		return 2;
+	}
+
+	const char* path = argv[arg];
+	struct sigaction action = { .sa_handler = server_signal };
+
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	// A client which disconnects before its replies are sent must not stop the server.
+	signal(SIGPIPE, SIG_IGN);
+
+	int listener = server_listen(path);
+
+	if (listener < 0) {
+		return 1;
+	}
+
+	server_epoll = epoll_create1(0);
+
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+
+	if (server_epoll < 0 || epoll_ctl(server_epoll, EPOLL_CTL_ADD, listener, &event) != 0) {
+		perror("epoll");
+		return 1;
+	}
+
+	if (snapshot == NULL) {
+		led_init();
+	} else if (!led_snapshot_load(snapshot)) {
+		fprintf(stderr, "%s: Missing or invalid snapshot, leds cleared\n", snapshot);
+	}
+
+	struct epoll_event events[SERVER_EVENTS];
+	uint64_t snapshot_due = server_now_ms() + SERVER_SNAPSHOT_INTERVAL_MS;
+	size_t snapshot_messages = 0;
+
+	while (!server_stop) {
+		if (snapshot != NULL && server_now_ms() >= snapshot_due) {
+			if (server_stats.messages != snapshot_messages && !led_snapshot_save(snapshot)) {
+				perror(snapshot);
+			}
+
+			snapshot_messages = server_stats.messages;
+			snapshot_due = server_now_ms() + SERVER_SNAPSHOT_INTERVAL_MS;
+		}
+
+		int ready = epoll_wait(server_epoll, events, SERVER_EVENTS, snapshot != NULL ? SERVER_SNAPSHOT_INTERVAL_MS : -1);
+
+		if (ready < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			perror("epoll_wait");
+			break;
+		}
+
+		size_t messages = server_stats.messages;
+
+		// All messages of this wake up are applied with a single register write.
+		led_begin();
+
+		for (int i = 0; i < ready; i++) {
+			ServerClient* client = events[i].data.ptr;
+
+			if (client == NULL) {
+				server_accept(listener);
+				continue;
+			}
+
+			int status = 0;
+
+			if (events[i].events & EPOLLOUT) {
+				status = server_flush(client);
+
+				if (status == 0) {
+					struct epoll_event in = { .events = EPOLLIN, .data.ptr = client };
+					status = epoll_ctl(server_epoll, EPOLL_CTL_MOD, client->fd, &in);
+				} else if (status > 0) {
+					status = 0;
+				}
+			} else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+				status = server_receive(client);
+			}
+
+			if (status != 0) {
+				server_close(client);
+			}
+		}
+
+		led_commit();
+
+		if (server_stats.messages != messages) {
+			server_stats.batches++;
+		}
+	}
+
+	close(listener);
+	close(server_epoll);
+	unlink(path);
+
+	if (snapshot != NULL && !led_snapshot_save(snapshot)) {
+		perror(snapshot);
+	}
+
+	fprintf(stderr, "clients=%zu bytes=%zu messages=%zu errors=%zu batches=%zu messages_per_batch=%.1f\n",
+		server_stats.clients,
+		server_stats.bytes,
+		server_stats.messages,
+		server_stats.errors,
+		server_stats.batches,
+		server_stats.batches > 0 ? (double)server_stats.messages / (double)server_stats.batches : 0.0);
+
+	return 0;
+}
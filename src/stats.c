@@ -0,0 +1,157 @@
+//! \file stats.c
+//! Implementation for the instrumentation.
+//!
+//! See stats.h for the available functions and documentation.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+#ifdef LED_STATS
+
+/// The live counters (atomic counterpart of #Stats).
+///
+/// Aligned to a cache line, the counters written by every message come first.
+typedef struct {
+	_Alignas(STATS_CACHE_LINE) _Atomic uint64_t register_writes;
+	_Atomic uint64_t register_writes_elided;
+	_Atomic uint64_t messages[256];
+	_Atomic uint64_t errors[STATS_ERROR_CODES];
+#ifdef LED_STATS_LATENCY
+	_Alignas(STATS_CACHE_LINE) _Atomic uint64_t latency[256][STATS_LATENCY_BUCKETS];
+#endif
+} StatsCounters;
+
+/// The live counters.
+StatsCounters stats_counters;
+
+bool stats_enabled(void) {
+	return true;
+}
+
+void stats_snapshot(Stats* snapshot) {
+	memset(snapshot, 0, sizeof(*snapshot));
+
+	snapshot->register_writes        = atomic_load_explicit(&stats_counters.register_writes, memory_order_relaxed);
+	snapshot->register_writes_elided = atomic_load_explicit(&stats_counters.register_writes_elided, memory_order_relaxed);
+
+	for (size_t op_code = 0; op_code < 256; op_code++) {
+		snapshot->messages[op_code] = atomic_load_explicit(&stats_counters.messages[op_code], memory_order_relaxed);
+
+#ifdef LED_STATS_LATENCY
+		for (size_t bucket = 0; bucket < STATS_LATENCY_BUCKETS; bucket++) {
+			snapshot->latency[op_code][bucket] = atomic_load_explicit(&stats_counters.latency[op_code][bucket], memory_order_relaxed);
+		}
+#endif
+	}
+
+	for (size_t code = 0; code < STATS_ERROR_CODES; code++) {
+		snapshot->errors[code] = atomic_load_explicit(&stats_counters.errors[code], memory_order_relaxed);
+	}
+}
+
+void stats_reset(void) {
+	atomic_store_explicit(&stats_counters.register_writes, 0, memory_order_relaxed);
+	atomic_store_explicit(&stats_counters.register_writes_elided, 0, memory_order_relaxed);
+
+	for (size_t op_code = 0; op_code < 256; op_code++) {
+		atomic_store_explicit(&stats_counters.messages[op_code], 0, memory_order_relaxed);
+
+#ifdef LED_STATS_LATENCY
+		for (size_t bucket = 0; bucket < STATS_LATENCY_BUCKETS; bucket++) {
+			atomic_store_explicit(&stats_counters.latency[op_code][bucket], 0, memory_order_relaxed);
+		}
+#endif
+	}
+
+	for (size_t code = 0; code < STATS_ERROR_CODES; code++) {
+		atomic_store_explicit(&stats_counters.errors[code], 0, memory_order_relaxed);
+	}
+}
+
+void stats_message(uint8_t op_code) {
+	atomic_fetch_add_explicit(&stats_counters.messages[op_code], 1, memory_order_relaxed);
+}
+
+void stats_error(int status) {
+	if (status == 0) {
+		return;
+	}
+
+	size_t code = status > 0 && status < STATS_ERROR_CODES ? (size_t)status : STATS_ERROR_CODES - 1;
+	atomic_fetch_add_explicit(&stats_counters.errors[code], 1, memory_order_relaxed);
+}
+
+void stats_latency(uint8_t op_code, uint64_t nanoseconds) {
+#ifdef LED_STATS_LATENCY
+	// Bucket = number of significant bits (0ns -> 0, 1ns -> 1, 2-3ns -> 2, ...).
+	size_t bucket = 0;
+
+	while (nanoseconds > 0 && bucket < STATS_LATENCY_BUCKETS - 1) {
+		nanoseconds >>= 1;
+		bucket++;
+	}
+
+	atomic_fetch_add_explicit(&stats_counters.latency[op_code][bucket], 1, memory_order_relaxed);
+#else
+	(void)op_code;
+	(void)nanoseconds;
+#endif
+}
+
+void stats_register_write(void) {
+	atomic_fetch_add_explicit(&stats_counters.register_writes, 1, memory_order_relaxed);
+}
+
+void stats_register_write_elided(void) {
+	atomic_fetch_add_explicit(&stats_counters.register_writes_elided, 1, memory_order_relaxed);
+}
+
+#else
+
+// Not compiled in, everything is a no-op.
+
+bool stats_enabled(void) {
+	return false;
+}
+
+void stats_snapshot(Stats* snapshot) {
+	memset(snapshot, 0, sizeof(*snapshot));
+}
+
+void stats_reset(void) {
+}
+
+void stats_message(uint8_t op_code) {
+	(void)op_code;
+}
+
+void stats_error(int status) {
+	(void)status;
+}
+
+void stats_latency(uint8_t op_code, uint64_t nanoseconds) {
+	(void)op_code;
+	(void)nanoseconds;
+}
+
+void stats_register_write(void) {
+}
+
+void stats_register_write_elided(void) {
+}
+
+#endif
+
+uint64_t stats_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
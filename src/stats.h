@@ -0,0 +1,115 @@
+//! \file stats.h
+//!
+//! Low overhead instrumentation of the message processing and led register.
+//!
+//! Counts:
+//! - processed messages per op code
+//! - failed messages per #MsgErrorCode
+//! - led register writes which where issued and which where elided by a led
+//!   transaction (see led_commit())
+//! - optionally a latency histogram per op code
+//!
+//! The counters are only compiled in if `LED_STATS` is defined when building
+//! the library (e.g. `make FEATURES=LED_STATS`), the latency histogram
+//! additionally requires `LED_STATS_LATENCY`. Without them all hooks compile
+//! to nothing.
+//!
+//! Counters are updated with relaxed atomic operations (no locks), so they can
+//! be read with stats_snapshot() at any time from any thread.
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Number of error code counters. Error codes at or above this value are
+/// counted in the last counter.
+#define STATS_ERROR_CODES 64
+
+/// Number of buckets of the latency histogram.
+///
+/// Bucket `n` counts messages which took less than `2^n` nanoseconds (and at
+/// least `2^(n-1)`), the last bucket counts all slower messages.
+#define STATS_LATENCY_BUCKETS 32
+
+/// Size of a cache line, used to align the statistics.
+#define STATS_CACHE_LINE 64
+
+/// A snapshot of the statistics.
+typedef struct {
+	/// Processed messages per op code (successfully or not).
+	uint64_t messages[256];
+	/// Failed messages per error code (index is the #MsgErrorCode).
+	uint64_t errors[STATS_ERROR_CODES];
+	/// Writes of the led register.
+	uint64_t register_writes;
+	/// Committed led transactions which did not need a register write.
+	uint64_t register_writes_elided;
+	/// Latency histogram per op code (all `0` without `LED_STATS_LATENCY`).
+	uint64_t latency[256][STATS_LATENCY_BUCKETS];
+} Stats;
+
+/// Returns if the statistics are compiled into the library.
+bool stats_enabled(void);
+
+/// Copies the current statistics into `snapshot`.
+///
+/// The counters are read one by one, so the snapshot is not atomic as a whole.
+///
+/// @param snapshot Receives the statistics (all `0` if they are not enabled).
+void stats_snapshot(Stats* snapshot);
+
+/// Resets all counters to `0`.
+void stats_reset(void);
+
+/*
+ * Hooks (used by the library)
+ */
+
+/// Counts a processed message.
+///
+/// @param op_code The op code of the message.
+void stats_message(uint8_t op_code);
+
+/// Counts a failed message.
+///
+/// @param status The result of the processing (#MsgErrorCode, `0` is ignored).
+void stats_error(int status);
+
+/// Adds a message to the latency histogram.
+///
+/// @param op_code The op code of the message.
+/// @param nanoseconds The time it took to process the message.
+void stats_latency(uint8_t op_code, uint64_t nanoseconds);
+
+/// Returns a monotonic timestamp in nanoseconds (for stats_latency()).
+uint64_t stats_now(void);
+
+/// Counts a write of the led register.
+void stats_register_write(void);
+
+/// Counts an elided write of the led register.
+void stats_register_write_elided(void);
+
+#ifdef LED_STATS
+#define STATS_MESSAGE(op_code)            stats_message(op_code)
+#define STATS_ERROR(status)               stats_error(status)
+#define STATS_REGISTER_WRITE()            stats_register_write()
+#define STATS_REGISTER_WRITE_ELIDED()     stats_register_write_elided()
+#else
+#define STATS_MESSAGE(op_code)            ((void)0)
+#define STATS_ERROR(status)               ((void)0)
+#define STATS_REGISTER_WRITE()            ((void)0)
+#define STATS_REGISTER_WRITE_ELIDED()     ((void)0)
+#endif
+
+#if defined(LED_STATS) && defined(LED_STATS_LATENCY)
+#define STATS_LATENCY_START(start)        uint64_t start = stats_now()
+#define STATS_LATENCY_END(start, op_code) stats_latency(op_code, stats_now() - (start))
+#else
+#define STATS_LATENCY_START(start)        ((void)0)
+#define STATS_LATENCY_END(start, op_code) ((void)0)
+#endif
+
+#endif
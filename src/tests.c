@@ -2,20 +2,53 @@
 //!
 //! A small collection of tests to test the functionality of the led/msg libraries.
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <threads.h>
 
 #include "led.h"
+#include "led_apply.h"
+#include "led_atomic.h"
+#include "led_bank.h"
+#include "led_effect.h"
+#include "led_frame.h"
+#include "led_pack.h"
+#include "led_preset.h"
+#include "led_snapshot.h"
 #include "msg.h"
+#include "msg_coalesce.h"
+#include "msg_queue.h"
+#include "msg_sched.h"
 #include "registers.h"
+#include "registers_shm.h"
+#include "stats.h"
+#include "trace.h"
 
 #define UINT8_T_BITS sizeof(uint8_t) * 8
 
-/// Calls assert_bits_eq() with some values prefilled.
-#define assert_led_bits(bits, message) assert_bits_eq(LED, bits, message, __FILE__, __func__, __LINE__)
+/// Number of updates each thread of the atomic stress test does.
+#define ATOMIC_STRESS_ITERATIONS 200000
+/// Number of threads of the atomic stress test (one per led section).
+#define ATOMIC_STRESS_THREADS 3
+/// Number of frames the writer of the frame stress test publishes.
+#define FRAME_STRESS_FRAMES 2000
+/// Number of reader threads of the frame stress test.
+#define FRAME_STRESS_READERS 2
+/// Number of bank writes of the registers stress test.
+#define REGISTERS_STRESS_WRITES 2000
+
+/// Calls assert_bits_eq() for a register value (`bits` in the default layout, see default_layout()).
+#define assert_register_bits(value, bits, message) assert_bits_eq(default_layout(value), bits, message, __FILE__, __func__, __LINE__)
+/// Calls assert_register_bits() for the led register.
+#define assert_led_bits(bits, message) assert_register_bits(LED, bits, message)
+/// Calls assert_register_bits() for a led of the led bank.
+#define assert_bank_bits(led, bits, message) assert_register_bits(LED_BANK[led], bits, message)
 /// Calls assert_msg_process() with some values prefilled.
 #define assert_msg_process(is, should, message) assert_msg_process_full(is, should, message, __FILE__, __func__, __LINE__)
+/// Calls assert_size_eq_full() with some values prefilled.
+#define assert_size_eq(is, should, message) assert_size_eq_full(is, should, message, __FILE__, __func__, __LINE__)
 
 /// Pretty prints the bits of a `uint8_t`.
 ///
@@ -104,6 +137,60 @@ int assert_bits_eq(uint8_t is, uint32_t should, const char* message, const char*
 	return 0;
 }
 
+/// Moves the sections of a register value from the layout of the board to
+/// the default layout (see board.h), so the expected bits of the tests are
+/// the same for all boards.
+///
+/// @param value The register value (or mask) in the layout of the board.
+///
+/// @return The value in the default layout.
+uint8_t default_layout(uint8_t value) {
+	return ((value >> LED_STATE_OFFSET) & LED_STATE_VALUE_MASK)
+		| ((value >> LED_COLOR_OFFSET) & LED_COLOR_VALUE_MASK) << 1
+		| ((value >> LED_BRIGHTNESS_OFFSET) & LED_BRIGHTNESS_VALUE_MASK) << 4;
+}
+
+/// Moves the sections of a register value from the default layout to the
+/// layout of the board (inverse of default_layout()).
+///
+/// @param value The register value in the default layout.
+///
+/// @return The value in the layout of the board.
+uint8_t board_layout(uint8_t value) {
+	return (value & LED_STATE_VALUE_MASK) << LED_STATE_OFFSET
+		| ((value >> 1) & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET
+		| ((value >> 4) & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET;
+}
+
+/// Checks that two sizes/counts are equal.
+/// If not `message` will be printed and `1` returned.
+///
+/// @param is The value to check.
+/// @param should The expected value.
+/// @param message Optional message to print if the assertion fails.
+/// @param file The file in which the assertion is located (filled in by the assert_size_eq macro)
+/// @param func The func in which the assertion is located (filled in by the assert_size_eq macro)
+/// @param line The line which the assertion is located on (filled in by the assert_size_eq macro)
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int assert_size_eq_full(size_t is, size_t should, const char* message, const char* file, const char* func, unsigned int line) {
+	if (is != should) {
+		printf("%s:%u <%s> Assert failed: ", file, line, func);
+
+		if (message != NULL) {
+			printf("%s", message);
+		} else {
+			printf("Values do not match");
+		}
+
+		printf("\n\tIs    : %zu\n\tShould: %zu\n", is, should);
+
+		return 1;
+	}
+
+	return 0;
+}
+
 // NOTE: Do not change the order of the test cases, they build up on each other.
 /// Unit/Integration tests for the led interface (led.h / led.c).
 /// @return `0` if every test succeeded, `1` otherwise.
@@ -162,6 +249,196 @@ int test_led() {
 	led_brightness_max();
 	status |= assert_led_bits(11110110, "Max brightness 2");
 
+	// Transactions only write the register on commit
+	led_begin();
+	led_color_blue();
+	led_brightness_set(0x3);
+	led_state_on();
+	status |= assert_led_bits(11110110, "Transaction (pending)");
+	status |= assert_size_eq(led_commit(), true, "Transaction (commit written)");
+	status |= assert_led_bits(111001, "Transaction (committed)");
+
+	// Nested transactions only write on the outermost commit
+	led_begin();
+	led_begin();
+	led_clear();
+	status |= assert_size_eq(led_commit(), false, "Nested transaction (inner commit)");
+	status |= assert_led_bits(111001, "Nested transaction (pending)");
+	status |= assert_size_eq(led_commit(), true, "Nested transaction (outer commit)");
+	status |= assert_led_bits(0, "Nested transaction (committed)");
+
+	// Unchanged values are not written
+	led_begin();
+	led_state_on();
+	led_state_off();
+	status |= assert_size_eq(led_commit(), false, "Transaction (elided)");
+	status |= assert_led_bits(0, "Transaction (elided)");
+
+	return status;
+}
+
+// NOTE: Do not change the order of the test cases, they build up on each other.
+/// Unit/Integration tests for the led bank interface (led_bank.h / led_bank.c).
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_led_bank() {
+	printf("Running led bank interface tests\n");
+
+	int status = 0;
+
+	led_bank_init();
+	status |= assert_bank_bits(0, 0, "bank: Init (first)");
+	status |= assert_bank_bits(LED_BANK_SIZE - 1, 0, "bank: Init (last)");
+
+	// Single leds
+	led_bank_state_on(3);
+	status |= assert_bank_bits(3, 1, "bank: State on");
+	status |= assert_bank_bits(2, 0, "bank: State on (neighbour before)");
+	status |= assert_bank_bits(4, 0, "bank: State on (neighbour after)");
+
+	led_bank_color_set(3, LED_COLOR_RED | LED_COLOR_BLUE);
+	status |= assert_bank_bits(3, 1011, "bank: Colors red|blue");
+
+	led_bank_brightness_max(3);
+	status |= assert_bank_bits(3, 11111011, "bank: Max brightness");
+
+	led_bank_color_green(3);
+	led_bank_brightness_set(3, 0x5);
+	led_bank_state_off(3);
+	status |= assert_bank_bits(3, 1010100, "bank: Green, 5 brightness, off");
+
+	// Out of bounds handles are ignored
+	led_bank_state_on(LED_BANK_SIZE);
+	status |= assert_bank_bits(LED_BANK_SIZE - 1, 0, "bank: Out of bounds");
+
+	// Ranges
+	led_bank_clear();
+	led_bank_state_set_range(8, 4, LED_STATE_ON);
+	status |= assert_bank_bits(7, 0, "bank: Range state (before)");
+	status |= assert_bank_bits(8, 1, "bank: Range state (first)");
+	status |= assert_bank_bits(11, 1, "bank: Range state (last)");
+	status |= assert_bank_bits(12, 0, "bank: Range state (after)");
+
+	led_bank_settings_set_range(10, 4, LED_COLOR_GREEN, 0xa);
+	status |= assert_bank_bits(9, 1, "bank: Range settings (before)");
+	status |= assert_bank_bits(10, 10100101, "bank: Range settings (first)");
+	status |= assert_bank_bits(13, 10100100, "bank: Range settings (last)");
+	status |= assert_bank_bits(14, 0, "bank: Range settings (after)");
+
+	led_bank_color_set_range(10, 2, LED_COLOR_BLUE);
+	led_bank_brightness_set_range(11, 1, LED_BRIGHTNESS_MAX);
+	status |= assert_bank_bits(10, 10101001, "bank: Range color");
+	status |= assert_bank_bits(11, 11111001, "bank: Range color/brightness");
+
+	// Ranges reaching past the end of the bank are truncated
+	led_bank_state_set_range(LED_BANK_SIZE - 2, 10, LED_STATE_ON);
+	status |= assert_bank_bits(LED_BANK_SIZE - 3, 0, "bank: Truncated range (before)");
+	status |= assert_bank_bits(LED_BANK_SIZE - 1, 1, "bank: Truncated range (last)");
+
+	// Masks
+	led_bank_clear();
+	uint8_t led_mask[LED_BANK_MASK_SIZE] = { 0 };
+	led_mask[0] = 0x81; // leds 0 and 7
+	led_mask[2] = 0x02; // led 17
+
+	led_bank_state_set_mask(led_mask, LED_STATE_ON);
+	led_bank_settings_set_mask(led_mask, LED_COLOR_RED, 0x3);
+	status |= assert_bank_bits(0, 110011, "bank: Mask (0)");
+	status |= assert_bank_bits(1, 0, "bank: Mask (1)");
+	status |= assert_bank_bits(7, 110011, "bank: Mask (7)");
+	status |= assert_bank_bits(8, 0, "bank: Mask (8)");
+	status |= assert_bank_bits(17, 110011, "bank: Mask (17)");
+
+	led_mask[0] = 0x01;
+	led_bank_color_set_mask(led_mask, LED_COLOR_GREEN);
+	led_bank_brightness_set_mask(led_mask, LED_BRIGHTNESS_MIN);
+	status |= assert_bank_bits(0, 101, "bank: Mask color/brightness (0)");
+	status |= assert_bank_bits(7, 110011, "bank: Mask color/brightness (7)");
+	status |= assert_bank_bits(17, 101, "bank: Mask color/brightness (17)");
+
+	return status;
+}
+
+/// A thread of the atomic stress test.
+///
+/// Each worker owns one section of the led register, no other thread writes
+/// this section. So after every update the section must hold the value which
+/// was just written. A lost update (torn read-modify-write by another thread)
+/// shows up as a mismatch.
+typedef struct {
+	/// The section the worker updates (`0` state, `1` color, `2` brightness).
+	int section;
+	/// Number of read backs which did not match the written value.
+	unsigned int failures;
+} AtomicStressWorker;
+
+/// Entry point of the atomic stress test threads (see AtomicStressWorker).
+int atomic_stress_worker(void* arg) {
+	AtomicStressWorker* worker = arg;
+	_Atomic uint8_t* led = (_Atomic uint8_t*)&LED;
+
+	for (unsigned int i = 0; i < ATOMIC_STRESS_ITERATIONS; i++) {
+		uint8_t value = i & 0x1;
+		uint8_t expected;
+		uint8_t mask;
+
+		switch (worker->section) {
+			case 0:
+				led_atomic_state_set(value);
+				expected = value << LED_STATE_OFFSET;
+				mask     = LED_STATE_MASK;
+				break;
+			case 1:
+				led_atomic_color_set(value ? LED_COLOR_RED | LED_COLOR_BLUE : LED_COLOR_GREEN);
+				expected = (value ? LED_COLOR_RED | LED_COLOR_BLUE : LED_COLOR_GREEN) << LED_COLOR_OFFSET;
+				mask     = LED_COLOR_MASK;
+				break;
+			default:
+				led_atomic_brightness_set(value ? LED_BRIGHTNESS_MAX : 0x5);
+				expected = (value ? LED_BRIGHTNESS_MAX : 0x5) << LED_BRIGHTNESS_OFFSET;
+				mask     = LED_BRIGHTNESS_MASK;
+				break;
+		}
+
+		if ((atomic_load_explicit(led, memory_order_relaxed) & mask) != expected) {
+			worker->failures++;
+		}
+	}
+
+	return 0;
+}
+
+// NOTE: The test uses the led register, it must not run concurrently with other tests.
+/// Stress tests for the thread safe led interface (led_atomic.h / led_atomic.c).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_led_atomic() {
+	printf("Running led atomic stress tests\n");
+
+	int status = 0;
+
+	led_atomic_clear();
+
+	AtomicStressWorker workers[ATOMIC_STRESS_THREADS];
+	thrd_t threads[ATOMIC_STRESS_THREADS];
+
+	for (int i = 0; i < ATOMIC_STRESS_THREADS; i++) {
+		workers[i].section  = i;
+		workers[i].failures = 0;
+
+		if (thrd_create(&threads[i], atomic_stress_worker, &workers[i]) != thrd_success) {
+			printf("Failed to create thread %d\n", i);
+			return 1;
+		}
+	}
+
+	for (int i = 0; i < ATOMIC_STRESS_THREADS; i++) {
+		thrd_join(threads[i], NULL);
+		status |= assert_size_eq(workers[i].failures, 0, "atomic: Lost updates");
+	}
+
+	// The last iteration of every worker wrote the value for `value == 1`.
+	status |= assert_led_bits(11111011, "atomic: Final state");
+
 	return status;
 }
 
@@ -221,6 +498,16 @@ int assert_msg_process_full(int process_result, int expected, const char* messag
 	return 0;
 }
 
+/// Handler for an op code registered by the tests, sets the brightness to the
+/// first parameter.
+int process_test_op_brightness(uint8_t len, const uint8_t* buffer) {
+	(void)len;
+
+	led_brightness_set(buffer[1]);
+
+	return 0;
+}
+
 // NOTE: Do not change the order of the test cases, they build up on each other.
 /// Unit/Integration tests for the message processing interface (msg.h / msg.c).
 ///
@@ -302,24 +589,1289 @@ int test_msg() {
 	msg_buf[1] = 0x00;
 	status |= assert_msg_process(process_message(2, msg_buf), MSG_ERROR_CODE_MISSING_PARAMETERS, "Missing parameters (settings/2)");
 
+	// Reserved bits are ignored
+	led_clear();
+	msg_buf[0] = 0x02;
+	msg_buf[1] = 0xf8 | LED_COLOR_BLUE;
+	msg_buf[2] = 0xf0 | 0x1;
+	status |= assert_msg_process(process_message(3, msg_buf), 0, "Reserved bits");
+	status |= assert_led_bits(11000, "msg: Reserved bits");
+
+	// Registered op code (brightness only, 2 - 3 bytes)
+	MsgOpDescriptor custom = { process_test_op_brightness, 2, 3, { 0xf0, 0xff }, NULL };
+	status |= assert_size_eq(msg_op_register(0xf0, &custom), true, "Register op code");
+	msg_buf[0] = 0xf0;
+	msg_buf[1] = 0xf0 | LED_BRIGHTNESS_MAX;
+	status |= assert_msg_process(process_message(2, msg_buf), 0, "Registered op code");
+	status |= assert_led_bits(11111000, "msg: Registered op code");
+	status |= assert_msg_process(process_message(1, msg_buf), MSG_ERROR_CODE_MISSING_PARAMETERS, "Registered op code (missing parameters)");
+	status |= assert_msg_process(process_message(4, msg_buf), MSG_ERROR_CODE_TRAILING_BYTES, "Registered op code (trailing bytes)");
+	status |= assert_size_eq(msg_frame_length(0xf0), 3, "Registered op code (frame length)");
+
+	// Invalid descriptors are rejected
+	MsgOpDescriptor invalid = { process_test_op_brightness, 3, 2, { 0 }, NULL };
+	status |= assert_size_eq(msg_op_register(0xf1, &invalid), false, "Register invalid op code");
+	MsgOpDescriptor no_handler = { NULL, 1, 1, { 0 }, NULL };
+	status |= assert_size_eq(msg_op_register(0xf1, &no_handler), false, "Register op code without handler");
+	uint8_t msg_no_handler[] = { 0xf1 };
+	status |= assert_msg_process(process_message(sizeof(msg_no_handler), msg_no_handler), MSG_ERROR_CODE_INVALID_OP_CODE, "Op code without handler");
+
+	// Unregistered op codes are invalid again
+	status |= assert_size_eq(msg_op_register(0xf0, NULL), true, "Unregister op code");
+	status |= assert_msg_process(process_message(2, msg_buf), MSG_ERROR_CODE_INVALID_OP_CODE, "Unregistered op code");
+
+	// Register image (state on, color green, brightness 10)
+	led_clear();
+	msg_buf[0] = MSG_OP_CODE_REGISTER_IMAGE;
+	msg_buf[1] = 0xa5;
+	status |= assert_msg_process(process_message(2, msg_buf), 0, "Register image");
+	status |= assert_led_bits(10100101, "msg: Register image");
+
+	uint8_t image_value;
+	uint8_t image_mask = msg_op_descriptor(MSG_OP_CODE_REGISTER_IMAGE)->bits(msg_buf, &image_value);
+	status |= assert_size_eq(image_mask, 0xff, "Register image bits (mask)");
+	status |= assert_size_eq(image_value, LED, "Register image bits (value)");
+
+	// Brightness up/down/step saturate
+	msg_buf[0] = MSG_OP_CODE_BRIGHTNESS_UP;
+	status |= assert_msg_process(process_message(1, msg_buf), 0, "Brightness up");
+	status |= assert_led_bits(10110101, "msg: Brightness up");
+	msg_buf[0] = MSG_OP_CODE_BRIGHTNESS_STEP;
+	msg_buf[1] = 10;
+	status |= assert_msg_process(process_message(2, msg_buf), 0, "Brightness step (+10)");
+	status |= assert_led_bits(11110101, "msg: Brightness step (saturated at max)");
+	msg_buf[0] = MSG_OP_CODE_BRIGHTNESS_UP;
+	status |= assert_msg_process(process_message(1, msg_buf), 0, "Brightness up (max)");
+	status |= assert_led_bits(11110101, "msg: Brightness up (max)");
+	msg_buf[0] = MSG_OP_CODE_BRIGHTNESS_STEP;
+	msg_buf[1] = 0xfd; // -3
+	status |= assert_msg_process(process_message(2, msg_buf), 0, "Brightness step (-3)");
+	status |= assert_led_bits(11000101, "msg: Brightness step (-3)");
+	msg_buf[0] = MSG_OP_CODE_BRIGHTNESS_DOWN;
+	status |= assert_msg_process(process_message(1, msg_buf), 0, "Brightness down");
+	status |= assert_led_bits(10110101, "msg: Brightness down");
+	msg_buf[0] = MSG_OP_CODE_REGISTER_IMAGE;
+	msg_buf[1] = 0x11;
+	status |= assert_msg_process(process_message(2, msg_buf), 0, "Register image (2)");
+	status |= assert_led_bits(10001, "msg: Register image (2)");
+	msg_buf[0] = MSG_OP_CODE_BRIGHTNESS_DOWN;
+	status |= assert_msg_process(process_message(1, msg_buf), 0, "Brightness down (2)");
+	status |= assert_msg_process(process_message(1, msg_buf), 0, "Brightness down (min)");
+	status |= assert_led_bits(1, "msg: Brightness down (saturated at min)");
+
+	// Color toggle (reserved bits are ignored)
+	msg_buf[0] = MSG_OP_CODE_COLOR_TOGGLE;
+	msg_buf[1] = 0xf8 | LED_COLOR_RED | LED_COLOR_BLUE;
+	status |= assert_msg_process(process_message(2, msg_buf), 0, "Color toggle");
+	status |= assert_led_bits(1011, "msg: Color toggle");
+	msg_buf[1] = LED_COLOR_RED;
+	status |= assert_msg_process(process_message(2, msg_buf), 0, "Color toggle (2)");
+	status |= assert_led_bits(1001, "msg: Color toggle (2)");
+
+	// ERROR - Delta op code lengths
+	msg_buf[0] = MSG_OP_CODE_BRIGHTNESS_UP;
+	status |= assert_msg_process(process_message(2, msg_buf), MSG_ERROR_CODE_TRAILING_BYTES, "Trailing bytes (brightness up)");
+	msg_buf[0] = MSG_OP_CODE_COLOR_TOGGLE;
+	status |= assert_msg_process(process_message(1, msg_buf), MSG_ERROR_CODE_MISSING_PARAMETERS, "Missing parameters (color toggle)");
+	status |= assert_led_bits(1001, "msg: Delta op code errors");
+
+	return status;
+}
+
+// NOTE: Do not change the order of the test cases, they build up on each other.
+/// Unit/Integration tests for the streaming message decoder (msg.h / msg.c).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_msg_stream() {
+	printf("Running msg stream tests\n");
+
+	int status = 0;
+
+	led_clear();
+
+	MsgStream stream;
+	MsgStreamResult result;
+	msg_stream_init(&stream);
+
+	// on | settings (green, 5) | off | settings (first byte only)
+	uint8_t chunk_1[] = { 0x00, 0x02, LED_COLOR_GREEN, 0x5, 0x01, 0x02 };
+	status |= assert_size_eq(msg_stream_process(&stream, sizeof(chunk_1), chunk_1, &result), 3, "stream: Frames (1)");
+	status |= assert_size_eq(result.bytes, 5, "stream: Bytes (1)");
+	status |= assert_size_eq(result.errors, 0, "stream: Errors (1)");
+	status |= assert_led_bits(1010100, "stream: Chunk (1)");
+
+	// settings (second byte only)
+	uint8_t chunk_2[] = { LED_COLOR_RED };
+	status |= assert_size_eq(msg_stream_process(&stream, sizeof(chunk_2), chunk_2, &result), 0, "stream: Frames (2)");
+	status |= assert_size_eq(result.bytes, 0, "stream: Bytes (2)");
+	status |= assert_led_bits(1010100, "stream: Chunk (2)");
+
+	// settings (last byte) | invalid op code | on
+	uint8_t chunk_3[] = { LED_BRIGHTNESS_MAX, 0x05, 0x00 };
+	status |= assert_size_eq(msg_stream_process(&stream, sizeof(chunk_3), chunk_3, &result), 3, "stream: Frames (3)");
+	status |= assert_size_eq(result.bytes, 3, "stream: Bytes (3)");
+	status |= assert_size_eq(result.errors, 1, "stream: Errors (3)");
+	status |= assert_msg_process(result.last_error, MSG_ERROR_CODE_INVALID_OP_CODE, "stream: Last error (3)");
+	status |= assert_led_bits(11110011, "stream: Chunk (3)");
+
+	// Empty buffer
+	status |= assert_size_eq(msg_stream_process(&stream, 0, chunk_3, NULL), 0, "stream: Empty");
+
+	// Results per message: off | settings (first byte only) ... settings (rest) | invalid op code
+	uint8_t results[8] = { 0 };
+	uint8_t chunk_4[] = { 0x01, 0x02 };
+	uint8_t chunk_5[] = { LED_COLOR_BLUE, 0x2, 0x05 };
+	status |= assert_size_eq(msg_stream_process_results(&stream, sizeof(chunk_4), chunk_4, results, NULL), 1, "stream: Results frames (4)");
+	status |= assert_msg_process(results[0], 0, "stream: Result off");
+	status |= assert_size_eq(msg_stream_process_results(&stream, sizeof(chunk_5), chunk_5, results, &result), 2, "stream: Results frames (5)");
+	status |= assert_msg_process(results[0], 0, "stream: Result settings");
+	status |= assert_msg_process(results[1], MSG_ERROR_CODE_INVALID_OP_CODE, "stream: Result invalid");
+	status |= assert_led_bits(101000, "stream: Results");
+
 	return status;
 }
 
-#if defined STM32F767ZI
-#define _LED_COUNT 3
-#elif defined STM32L162
-#define _LED_COUNT 1
-#else
-#error No valid target mc defined
+// NOTE: Do not change the order of the test cases, they build up on each other.
+/// Unit/Integration tests for the batch processing (process_messages()).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_msg_batch() {
+	printf("Running msg batch tests\n");
+
+	int status = 0;
+
+	led_clear();
+
+	// on | settings (green, 5) | invalid op code | missing parameter | empty | blink (invalid period) | off
+	uint8_t buffer[] = { 0x00, 0x02, LED_COLOR_GREEN, 0x5, 0xff, 0x02, 0x01, 0x11, 0x01, 0x00, 0x01 };
+	MsgBatchEntry entries[] = { { 0, 1 }, { 1, 3 }, { 4, 1 }, { 5, 2 }, { 7, 0 }, { 7, 3 }, { 10, 1 } };
+	uint8_t successes[1] = { 0 };
+	MsgBatchError errors[4] = { { 0, 0 } };
+
+	status |= assert_size_eq(process_messages(buffer, entries, 7, successes, errors, 4), 4, "batch: Failures");
+	status |= assert_bits_eq(successes[0], 1000011, "batch: Successes", __FILE__, __func__, __LINE__);
+	status |= assert_size_eq(errors[0].index, 2, "batch: Error index (0)");
+	status |= assert_msg_process(errors[0].error, MSG_ERROR_CODE_INVALID_OP_CODE, "batch: Error (0)");
+	status |= assert_size_eq(errors[1].index, 3, "batch: Error index (1)");
+	status |= assert_msg_process(errors[1].error, MSG_ERROR_CODE_MISSING_PARAMETERS, "batch: Error (1)");
+	status |= assert_size_eq(errors[2].index, 4, "batch: Error index (2)");
+	status |= assert_msg_process(errors[2].error, MSG_ERROR_CODE_EMPTY, "batch: Error (2)");
+	status |= assert_size_eq(errors[3].index, 5, "batch: Error index (3)");
+	status |= assert_msg_process(errors[3].error, MSG_ERROR_CODE_INVALID_PARAMETERS, "batch: Error (3)");
+	status |= assert_led_bits(1010100, "batch: Applied in order");
+	status |= assert_size_eq(led_effect_active(), false, "batch: Failed handler");
+
+	// Multiple chunks, failures beyond the capacity are only counted
+	static MsgBatchEntry many[MSG_BATCH_CHUNK + 6];
+	uint8_t many_buffer[] = { 0x00, 0xff };
+	uint8_t many_successes[(MSG_BATCH_CHUNK + 6 + 7) / 8] = { 0 };
+
+	for (size_t i = 0; i < MSG_BATCH_CHUNK + 6; i++) {
+		many[i] = (MsgBatchEntry){ i == MSG_BATCH_CHUNK + 1 || i == 3 ? 1 : 0, 1 };
+	}
+
+	status |= assert_size_eq(process_messages(many_buffer, many, MSG_BATCH_CHUNK + 6, many_successes, errors, 1), 2, "batch: Chunks failures");
+	status |= assert_size_eq(errors[0].index, 3, "batch: Chunks first error");
+	status |= assert_bits_eq(many_successes[0], 11110111, "batch: Chunks successes (0)", __FILE__, __func__, __LINE__);
+	status |= assert_bits_eq(many_successes[MSG_BATCH_CHUNK / 8], 111101, "batch: Chunks successes (last)", __FILE__, __func__, __LINE__);
+	status |= assert_led_bits(1010101, "batch: Chunks applied");
+
+	// No messages and no outputs
+	status |= assert_size_eq(process_messages(buffer, entries, 0, NULL, NULL, 0), 0, "batch: Empty");
+	status |= assert_size_eq(process_messages(buffer, entries, 7, NULL, NULL, 0), 4, "batch: Without outputs");
+
+	return status;
+}
+
+// NOTE: Do not change the order of the test cases, they build up on each other.
+/// Unit/Integration tests for the message queue (msg_queue.h / msg_queue.c).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_msg_queue() {
+	printf("Running msg queue tests\n");
+
+	int status = 0;
+
+	led_clear();
+
+	// Static, the queue is too large to comfortably live on the stack.
+	static MsgQueue queue;
+	MsgQueueDrainResult result;
+	msg_queue_init(&queue);
+
+	uint8_t msg_on[]       = { 0x00 };
+	uint8_t msg_settings[] = { 0x02, LED_COLOR_BLUE, 0x7 };
+	uint8_t msg_invalid[]  = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+	status |= assert_size_eq(msg_queue_enqueue(&queue, sizeof(msg_on), msg_on), true, "queue: Enqueue on");
+	status |= assert_size_eq(msg_queue_enqueue(&queue, sizeof(msg_settings), msg_settings), true, "queue: Enqueue settings");
+	status |= assert_size_eq(msg_queue_enqueue(&queue, sizeof(msg_invalid), msg_invalid), true, "queue: Enqueue invalid");
+	status |= assert_size_eq(msg_queue_size(&queue), 3, "queue: Size");
+	status |= assert_led_bits(0, "queue: Deferred");
+
+	// Partial drain
+	status |= assert_size_eq(msg_queue_drain(&queue, 1, &result), 1, "queue: Drain (1)");
+	status |= assert_size_eq(result.errors, 0, "queue: Drain errors (1)");
+	status |= assert_led_bits(1, "queue: Drain (1)");
+
+	// Drain the rest; the truncated message must still fail as too long
+	status |= assert_size_eq(msg_queue_drain(&queue, MSG_QUEUE_CAPACITY, &result), 2, "queue: Drain (2)");
+	status |= assert_size_eq(result.errors, 1, "queue: Drain errors (2)");
+	status |= assert_msg_process(result.last_error, MSG_ERROR_CODE_TRAILING_BYTES, "queue: Drain last error (2)");
+	status |= assert_led_bits(1111001, "queue: Drain (2)");
+	status |= assert_size_eq(msg_queue_size(&queue), 0, "queue: Empty");
+
+	// Overflow
+	for (size_t i = 0; i < MSG_QUEUE_CAPACITY; i++) {
+		msg_queue_enqueue(&queue, sizeof(msg_on), msg_on);
+	}
+
+	status |= assert_size_eq(msg_queue_enqueue(&queue, sizeof(msg_on), msg_on), false, "queue: Full");
+	status |= assert_size_eq(msg_queue_dropped(&queue), 1, "queue: Dropped");
+	status |= assert_size_eq(msg_queue_drain(&queue, MSG_QUEUE_CAPACITY * 2, NULL), MSG_QUEUE_CAPACITY, "queue: Drain full");
+
+	return status;
+}
+
+/// Tests for the instrumentation (stats.h / stats.c).
+///
+/// Only checks the counters if the library was built with `LED_STATS`.
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_stats() {
+	printf("Running stats tests\n");
+
+	int status = 0;
+	static Stats stats;
+
+	stats_reset();
+	led_clear();
+
+	uint8_t msg_on[]       = { MSG_OP_CODE_ON };
+	uint8_t msg_settings[] = { MSG_OP_CODE_LED_SETTINGS, LED_COLOR_RED, 0x1 };
+	uint8_t msg_invalid[]  = { 0xff };
+
+	process_message(sizeof(msg_on), msg_on);       // write
+	process_message(sizeof(msg_on), msg_on);       // elided
+	process_message(sizeof(msg_settings), msg_settings); // write
+	process_message(sizeof(msg_invalid), msg_invalid);
+	process_message(2, msg_on);
+	process_message(0, msg_on);
+
+	stats_snapshot(&stats);
+
+	if (!stats_enabled()) {
+		status |= assert_size_eq(stats.messages[MSG_OP_CODE_ON], 0, "stats: Disabled");
+		return status;
+	}
+
+	status |= assert_size_eq(stats.messages[MSG_OP_CODE_ON], 3, "stats: Messages (on)");
+	status |= assert_size_eq(stats.messages[MSG_OP_CODE_LED_SETTINGS], 1, "stats: Messages (settings)");
+	status |= assert_size_eq(stats.messages[0xff], 1, "stats: Messages (invalid)");
+	status |= assert_size_eq(stats.errors[MSG_ERROR_CODE_INVALID_OP_CODE], 1, "stats: Errors (invalid op code)");
+	status |= assert_size_eq(stats.errors[MSG_ERROR_CODE_TRAILING_BYTES], 1, "stats: Errors (trailing bytes)");
+	status |= assert_size_eq(stats.errors[MSG_ERROR_CODE_EMPTY], 1, "stats: Errors (empty)");
+	// led_clear() + 2 messages
+	status |= assert_size_eq(stats.register_writes, 3, "stats: Register writes");
+	status |= assert_size_eq(stats.register_writes_elided, 1, "stats: Register writes elided");
+
+#ifdef LED_STATS_LATENCY
+	uint64_t latencies = 0;
+
+	for (size_t bucket = 0; bucket < STATS_LATENCY_BUCKETS; bucket++) {
+		latencies += stats.latency[MSG_OP_CODE_ON][bucket];
+	}
+
+	status |= assert_size_eq(latencies, 3, "stats: Latency (on)");
 #endif
 
+	// The setters are counted, also the header only ones (LED_INLINE)
+	led_state_off();
+	stats_snapshot(&stats);
+	status |= assert_size_eq(stats.register_writes, 4, "stats: Register writes (setter)");
+
+	stats_reset();
+	stats_snapshot(&stats);
+	status |= assert_size_eq(stats.messages[MSG_OP_CODE_ON], 0, "stats: Reset");
+
+	return status;
+}
+
+/// Tests for the register write recorder (trace.h / trace.c).
+///
+/// Only checks the recorded writes if the library was built with `LED_TRACE`.
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_trace() {
+	printf("Running trace tests\n");
+
+	int status = 0;
+	static TraceEntry entries[TRACE_CAPACITY];
+
+	trace_reset();
+
+	uint8_t msg_on[]       = { MSG_OP_CODE_ON };
+	uint8_t msg_settings[] = { MSG_OP_CODE_LED_SETTINGS, LED_COLOR_GREEN, 0x2 };
+
+	led_clear();
+	process_message(sizeof(msg_on), msg_on);
+	process_message(sizeof(msg_settings), msg_settings);
+
+	if (!trace_enabled()) {
+		status |= assert_size_eq(trace_count(), 0, "trace: Disabled");
+		return status;
+	}
+
+	size_t count = trace_read(entries, TRACE_CAPACITY);
+	status |= assert_size_eq(count, 3, "trace: Count");
+	status |= assert_size_eq(trace_count(), 3, "trace: Count (total)");
+
+	status |= assert_register_bits(entries[0].value, 0, "trace: Clear value");
+	status |= assert_register_bits(entries[0].mask, 11111111, "trace: Clear mask");
+	status |= assert_size_eq(entries[0].op_code, TRACE_NO_OP_CODE, "trace: Clear op code");
+
+	status |= assert_register_bits(entries[1].value, 1, "trace: On value");
+	status |= assert_register_bits(entries[1].mask, 1, "trace: On mask");
+	status |= assert_size_eq(entries[1].op_code, MSG_OP_CODE_ON, "trace: On op code");
+
+	status |= assert_register_bits(entries[2].value, 100101, "trace: Settings value");
+	status |= assert_register_bits(entries[2].mask, 11111110, "trace: Settings mask");
+	status |= assert_size_eq(entries[2].op_code, MSG_OP_CODE_LED_SETTINGS, "trace: Settings op code");
+	status |= assert_size_eq(entries[2].timestamp >= entries[0].timestamp, true, "trace: Timestamps");
+
+	// Only the most recent writes are kept
+	for (size_t i = 0; i < TRACE_CAPACITY; i++) {
+		msg_settings[2] = i & 0x1 ? LED_BRIGHTNESS_MAX : LED_BRIGHTNESS_MIN;
+		process_message(sizeof(msg_settings), msg_settings);
+	}
+
+	count = trace_read(entries, TRACE_CAPACITY);
+	status |= assert_size_eq(count, TRACE_CAPACITY, "trace: Wrapped count");
+	status |= assert_register_bits(entries[TRACE_CAPACITY - 1].value, 11110101, "trace: Wrapped last");
+
+	// The setters are recorded, also the header only ones (LED_INLINE)
+	led_color_set(LED_COLOR_RED);
+	count = trace_read(entries, TRACE_CAPACITY);
+	status |= assert_size_eq(trace_count(), 3 + TRACE_CAPACITY + 1, "trace: Setter count");
+	status |= assert_register_bits(entries[count - 1].mask, 1110, "trace: Setter mask");
+
+	// Dump
+	const char* path = "trace_test.bin";
+	status |= assert_size_eq(trace_dump(path), TRACE_CAPACITY, "trace: Dump");
+
+	FILE* file = fopen(path, "rb");
+	uint8_t header[12] = { 0 };
+
+	if (file != NULL) {
+		status |= assert_size_eq(fread(header, 1, sizeof(header), file), sizeof(header), "trace: Dump header");
+		fseek(file, 0, SEEK_END);
+		status |= assert_size_eq(ftell(file), sizeof(header) + TRACE_CAPACITY * TRACE_DUMP_ENTRY_SIZE, "trace: Dump size");
+		fclose(file);
+	}
+
+	remove(path);
+
+	status |= assert_size_eq(header[0] == 'L' && header[3] == 'C', true, "trace: Dump magic");
+	status |= assert_size_eq(header[4] | header[5] << 8, TRACE_DUMP_VERSION, "trace: Dump version");
+
+	trace_reset();
+
+	return status;
+}
+
+/// Tests for the led effects (led_effect.h / led_effect.c).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_effect() {
+	printf("Running effect tests\n");
+
+	int status = 0;
+
+	led_clear();
+	led_effect_stop();
+	led_tick(1000);
+
+	// Fade 0 -> 15 over 150 ticks
+	uint8_t msg_fade[] = { MSG_OP_CODE_EFFECT_FADE, 0xff, 150, 0 };
+	status |= assert_msg_process(process_message(sizeof(msg_fade), msg_fade), 0, "effect: Fade");
+	status |= assert_size_eq(led_effect_active(), true, "effect: Fade active");
+	// Same brightness as before, the write is elided
+	status |= assert_size_eq(led_tick(1000), false, "effect: Fade tick (0)");
+	status |= assert_led_bits(0, "effect: Fade (0)");
+	led_tick(1075);
+	status |= assert_led_bits(1110000, "effect: Fade (75)");
+	status |= assert_size_eq(led_tick(1076), false, "effect: Fade unchanged");
+	led_tick(1149);
+	status |= assert_led_bits(11100000, "effect: Fade (149)");
+	led_tick(1150);
+	status |= assert_led_bits(11110000, "effect: Fade (150)");
+	status |= assert_size_eq(led_effect_active(), false, "effect: Fade done");
+
+	// Fade down, without duration
+	msg_fade[1] = 0x2;
+	msg_fade[2] = 0;
+	process_message(sizeof(msg_fade), msg_fade);
+	led_tick(1150);
+	status |= assert_led_bits(100000, "effect: Fade immediate");
+
+	// Blink with a period of 10 ticks, across a wrap around of the time
+	uint8_t msg_blink[] = { MSG_OP_CODE_EFFECT_BLINK, 10, 0 };
+	led_tick(UINT32_MAX - 4);
+	status |= assert_msg_process(process_message(sizeof(msg_blink), msg_blink), 0, "effect: Blink");
+	led_tick(UINT32_MAX - 4);
+	status |= assert_led_bits(100001, "effect: Blink on");
+	led_tick(UINT32_MAX);
+	status |= assert_led_bits(100001, "effect: Blink on (4)");
+	led_tick(0);
+	status |= assert_led_bits(100000, "effect: Blink off (wrapped)");
+	led_tick(4);
+	status |= assert_led_bits(100000, "effect: Blink off (9)");
+	led_tick(5);
+	status |= assert_led_bits(100001, "effect: Blink on (next period)");
+	led_tick(5 + 10 * 1000 + 5);
+	status |= assert_led_bits(100000, "effect: Blink off (later)");
+
+	// Pulse with a period of 64 ticks, together with a blink with a period of 100 ticks
+	uint8_t msg_pulse[] = { MSG_OP_CODE_EFFECT_PULSE, 64, 0 };
+	msg_blink[1] = 100;
+	led_tick(20000);
+	status |= assert_msg_process(process_message(sizeof(msg_pulse), msg_pulse), 0, "effect: Pulse");
+	status |= assert_msg_process(process_message(sizeof(msg_blink), msg_blink), 0, "effect: Pulse blink");
+	led_tick(20000);
+	status |= assert_led_bits(1, "effect: Pulse (0)");
+	led_tick(20030);
+	status |= assert_led_bits(11110001, "effect: Pulse (30)");
+	led_tick(20062);
+	status |= assert_led_bits(0, "effect: Pulse (62)");
+	led_tick(20064 + 16);
+	status |= assert_led_bits(10000000, "effect: Pulse (next period)");
+
+	// Stop keeps the last output
+	uint8_t msg_stop[] = { MSG_OP_CODE_EFFECT_STOP };
+	status |= assert_msg_process(process_message(sizeof(msg_stop), msg_stop), 0, "effect: Stop");
+	status |= assert_size_eq(led_tick(20100), false, "effect: Stopped");
+	status |= assert_led_bits(10000000, "effect: Stopped");
+
+	// Invalid periods
+	msg_blink[1] = 1;
+	status |= assert_msg_process(process_message(sizeof(msg_blink), msg_blink), MSG_ERROR_CODE_INVALID_PARAMETERS, "effect: Invalid blink");
+	msg_pulse[1] = 0;
+	status |= assert_msg_process(process_message(sizeof(msg_pulse), msg_pulse), MSG_ERROR_CODE_INVALID_PARAMETERS, "effect: Invalid pulse");
+	status |= assert_size_eq(led_effect_active(), false, "effect: Invalid inactive");
+
+	// Fade after a settings message of the same transaction, starts from the new brightness
+	static MsgQueue queue;
+	msg_queue_init(&queue);
+	uint8_t msg_settings[] = { MSG_OP_CODE_LED_SETTINGS, LED_COLOR_RED, 0xf };
+	msg_fade[1] = 0x0;
+	msg_fade[2] = 100;
+	led_tick(30000);
+	msg_queue_enqueue(&queue, sizeof(msg_settings), msg_settings);
+	msg_queue_enqueue(&queue, sizeof(msg_fade), msg_fade);
+	status |= assert_size_eq(msg_queue_drain(&queue, MSG_QUEUE_CAPACITY, NULL), 2, "effect: Drain settings and fade");
+	led_tick(30000);
+	status |= assert_size_eq((LED & LED_BRIGHTNESS_MASK) >> LED_BRIGHTNESS_OFFSET, 0xf, "effect: Fade after settings (0)");
+	led_tick(30100);
+	status |= assert_size_eq((LED & LED_BRIGHTNESS_MASK) >> LED_BRIGHTNESS_OFFSET, 0x0, "effect: Fade after settings (100)");
+
+	led_clear();
+
+	return status;
+}
+
+/// Tests for the coalescing ingestion (msg_coalesce.h / msg_coalesce.c).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_msg_coalesce() {
+	printf("Running msg coalesce tests\n");
+
+	int status = 0;
+	MsgCoalesce coalesce;
+	MsgCoalesceResult result;
+
+	led_clear();
+	msg_coalesce_init(&coalesce);
+
+	uint8_t msg_on[]       = { MSG_OP_CODE_ON };
+	uint8_t msg_off[]      = { MSG_OP_CODE_OFF };
+	uint8_t msg_red[]      = { MSG_OP_CODE_LED_SETTINGS, LED_COLOR_RED, 0x1 };
+	uint8_t msg_blue[]     = { MSG_OP_CODE_LED_SETTINGS, LED_COLOR_BLUE | 0xf8, 0xf4 };
+	uint8_t msg_invalid[]  = { MSG_OP_CODE_ON, 0x00 };
+
+	// ON, settings, settings, OFF, settings: only OFF and the last settings remain
+	status |= assert_msg_process(msg_coalesce_add(&coalesce, sizeof(msg_on), msg_on), 0, "coalesce: Add on");
+	status |= assert_msg_process(msg_coalesce_add(&coalesce, sizeof(msg_red), msg_red), 0, "coalesce: Add red");
+	status |= assert_msg_process(msg_coalesce_add(&coalesce, sizeof(msg_red), msg_red), 0, "coalesce: Add red");
+	status |= assert_msg_process(msg_coalesce_add(&coalesce, sizeof(msg_off), msg_off), 0, "coalesce: Add off");
+	status |= assert_msg_process(msg_coalesce_add(&coalesce, sizeof(msg_blue), msg_blue), 0, "coalesce: Add blue");
+	status |= assert_msg_process(msg_coalesce_add(&coalesce, sizeof(msg_invalid), msg_invalid), MSG_ERROR_CODE_TRAILING_BYTES, "coalesce: Add invalid");
+	status |= assert_led_bits(0, "coalesce: Deferred");
+
+	status |= assert_size_eq(msg_coalesce_drain(&coalesce, &result), 5, "coalesce: Drain");
+	status |= assert_size_eq(result.coalesced, 3, "coalesce: Coalesced");
+	status |= assert_size_eq(result.written, true, "coalesce: Written");
+	status |= assert_led_bits(1001000, "coalesce: Net effect");
+
+	// Nothing pending
+	status |= assert_size_eq(msg_coalesce_drain(&coalesce, &result), 0, "coalesce: Drain empty");
+	status |= assert_size_eq(result.written, false, "coalesce: Drain empty");
+
+	// Messages without register bits apply the merged messages first
+	uint8_t msg_store[]  = { MSG_OP_CODE_PRESET_STORE, 0x0 };
+	uint8_t msg_recall[] = { MSG_OP_CODE_PRESET_RECALL };
+	msg_coalesce_add(&coalesce, sizeof(msg_on), msg_on);
+	msg_coalesce_add(&coalesce, sizeof(msg_red), msg_red);
+	status |= assert_msg_process(msg_coalesce_add(&coalesce, sizeof(msg_store), msg_store), 0, "coalesce: Add store");
+	status |= assert_led_bits(10011, "coalesce: Applied before store");
+	msg_coalesce_add(&coalesce, sizeof(msg_off), msg_off);
+	msg_coalesce_add(&coalesce, sizeof(msg_recall), msg_recall);
+	status |= assert_led_bits(10011, "coalesce: Superseded by recall");
+	msg_coalesce_add(&coalesce, sizeof(msg_blue), msg_blue);
+
+	status |= assert_size_eq(msg_coalesce_drain(&coalesce, &result), 4, "coalesce: Drain mixed");
+	status |= assert_size_eq(result.coalesced, 0, "coalesce: Coalesced mixed");
+	status |= assert_led_bits(1001001, "coalesce: Net effect mixed");
+	status |= assert_size_eq(msg_coalesce_coalesced(&coalesce), 3, "coalesce: Total coalesced");
+
+	led_clear();
+
+	return status;
+}
+
+/// Tests for the message scheduler (msg_sched.h / msg_sched.c).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_msg_sched() {
+	printf("Running msg scheduler tests\n");
+
+	int status = 0;
+	MsgSchedAdvanceResult result;
+
+	led_clear();
+	msg_sched_init(1000);
+
+	uint8_t msg_on[]       = { MSG_OP_CODE_ON };
+	uint8_t msg_off[]      = { MSG_OP_CODE_OFF };
+	uint8_t msg_settings[] = { MSG_OP_CODE_LED_SETTINGS, LED_COLOR_RED, 0x1 };
+
+	// Turn off in 500 ticks
+	uint8_t msg_schedule[] = { MSG_OP_CODE_SCHEDULE, 0x01, 0xf4, 0x01, MSG_OP_CODE_OFF, 0x00, 0x00, 0x00 };
+	process_message(sizeof(msg_on), msg_on);
+	status |= assert_msg_process(process_message(sizeof(msg_schedule), msg_schedule), 0, "sched: Schedule");
+	status |= assert_size_eq(msg_sched_pending(), 1, "sched: Pending");
+	status |= assert_size_eq(msg_sched_advance(1499, &result), 0, "sched: Not due");
+	status |= assert_led_bits(1, "sched: Not due");
+	status |= assert_size_eq(msg_sched_advance(1500, &result), 1, "sched: Due");
+	status |= assert_size_eq(result.errors, 0, "sched: Due errors");
+	status |= assert_led_bits(0, "sched: Due");
+	status |= assert_size_eq(msg_sched_pending(), 0, "sched: Fired");
+
+	// Cancel
+	msg_schedule[4] = MSG_OP_CODE_ON;
+	process_message(sizeof(msg_schedule), msg_schedule);
+	uint8_t msg_cancel[] = { MSG_OP_CODE_CANCEL, 0x01 };
+	status |= assert_msg_process(process_message(sizeof(msg_cancel), msg_cancel), 0, "sched: Cancel");
+	status |= assert_msg_process(process_message(sizeof(msg_cancel), msg_cancel), 0, "sched: Cancel (not pending)");
+	status |= assert_size_eq(msg_sched_advance(3000, NULL), 0, "sched: Cancelled");
+	status |= assert_led_bits(0, "sched: Cancelled");
+
+	// Same id replaces, messages due at the same tick are processed together
+	status |= assert_size_eq(msg_sched_after(7, 10, sizeof(msg_off), msg_off), true, "sched: After");
+	status |= assert_size_eq(msg_sched_after(7, 20, sizeof(msg_on), msg_on), true, "sched: Replace");
+	status |= assert_size_eq(msg_sched_at(8, 3020, sizeof(msg_settings), msg_settings), true, "sched: At");
+	status |= assert_size_eq(msg_sched_pending(), 2, "sched: Replace pending");
+	status |= assert_size_eq(msg_sched_advance(3019, NULL), 0, "sched: Batch not due");
+	status |= assert_size_eq(msg_sched_advance(3100, &result), 2, "sched: Batch");
+	status |= assert_led_bits(10011, "sched: Batch");
+
+	// Higher levels of the wheel and parked messages (beyond the wheel)
+	uint32_t due[] = { 3100 + 64, 3100 + 5000, 3100 + 300000, 3100 + 20000000, 3100 + 100000000 };
+
+	for (uint8_t i = 0; i < sizeof(due) / sizeof(due[0]); i++) {
+		msg_sched_at(i, due[i], sizeof(msg_off), msg_off);
+	}
+
+	for (uint8_t i = 0; i < sizeof(due) / sizeof(due[0]); i++) {
+		status |= assert_size_eq(msg_sched_advance(due[i] - 1, NULL), 0, "sched: Level not due");
+		status |= assert_size_eq(msg_sched_advance(due[i], NULL), 1, "sched: Level due");
+	}
+
+	// Wrap around of the time, a past time is due on the next tick
+	msg_sched_init(UINT32_MAX - 10);
+	msg_sched_after(1, 20, sizeof(msg_on), msg_on);
+	msg_sched_at(2, UINT32_MAX - 20, sizeof(msg_off), msg_off);
+	status |= assert_size_eq(msg_sched_advance(UINT32_MAX - 9, NULL), 1, "sched: Past");
+	status |= assert_size_eq(msg_sched_advance(8, NULL), 0, "sched: Wrapped not due");
+	status |= assert_size_eq(msg_sched_advance(9, NULL), 1, "sched: Wrapped due");
+	status |= assert_led_bits(10011, "sched: Wrapped");
+
+	// Invalid and too many messages
+	msg_schedule[4] = MSG_OP_CODE_SCHEDULE;
+	status |= assert_msg_process(process_message(sizeof(msg_schedule), msg_schedule), MSG_ERROR_CODE_INVALID_PARAMETERS, "sched: Nested schedule");
+	msg_schedule[4] = 0xff;
+	status |= assert_msg_process(process_message(sizeof(msg_schedule), msg_schedule), MSG_ERROR_CODE_INVALID_PARAMETERS, "sched: Invalid op code");
+
+	for (size_t i = 0; i < MSG_SCHED_CAPACITY; i++) {
+		msg_sched_after(i, 1, sizeof(msg_on), msg_on);
+	}
+
+	msg_schedule[1] = MSG_SCHED_CAPACITY;
+	msg_schedule[4] = MSG_OP_CODE_ON;
+	status |= assert_msg_process(process_message(sizeof(msg_schedule), msg_schedule), MSG_ERROR_CODE_NO_RESOURCES, "sched: Full");
+	status |= assert_size_eq(msg_sched_advance(10, &result), MSG_SCHED_CAPACITY, "sched: Full fired");
+	status |= assert_size_eq(msg_sched_pending(), 0, "sched: Empty");
+
+	led_clear();
+
+	return status;
+}
+
+/// Number of leds of the pack tests (not a multiple of any vector width).
+#define PACK_TEST_LEDS 1037
+
+/// Tests for the bulk pack/unpack (led_pack.h / led_pack.c).
+///
+/// Checks every implementation supported by the cpu against the expected
+/// layout.
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_pack() {
+	printf("Running pack tests\n");
+
+	int status = 0;
+	static uint8_t state[PACK_TEST_LEDS], color[PACK_TEST_LEDS], brightness[PACK_TEST_LEDS];
+	static uint8_t packed[PACK_TEST_LEDS], expected[PACK_TEST_LEDS];
+	static uint8_t state_out[PACK_TEST_LEDS], color_out[PACK_TEST_LEDS], brightness_out[PACK_TEST_LEDS];
+
+	// Includes bits outside of the sections, which must be ignored.
+	for (size_t i = 0; i < PACK_TEST_LEDS; i++) {
+		state[i]      = (uint8_t)(i * 7);
+		color[i]      = (uint8_t)(i * 13 + 5);
+		brightness[i] = (uint8_t)(i * 31 + 3);
+		expected[i]   = board_layout((state[i] & 0x1) | (color[i] & 0x7) << 1 | (brightness[i] & 0xf) << 4);
+	}
+
+	status |= assert_size_eq(led_pack_supported(LED_PACK_SCALAR), true, "pack: Scalar supported");
+	status |= assert_size_eq(led_pack_select(LED_PACK_IMPLEMENTATIONS), false, "pack: Invalid implementation");
+
+	for (int implementation = LED_PACK_SCALAR; implementation < LED_PACK_IMPLEMENTATIONS; implementation++) {
+		if (!led_pack_select(implementation)) {
+			printf("  %s not supported, skipped\n", led_pack_implementation_name(implementation));
+			continue;
+		}
+
+		status |= assert_size_eq(led_pack_implementation(), implementation, "pack: Selected");
+
+		// Different lengths to cover the scalar tails of the kernels
+		size_t counts[] = { 0, 1, 15, 16, 33, PACK_TEST_LEDS };
+
+		for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+			size_t count = counts[c];
+			size_t mismatches = 0;
+
+			for (size_t i = 0; i < PACK_TEST_LEDS; i++) {
+				packed[i] = 0xaa;
+			}
+
+			led_pack(count, state, color, brightness, packed);
+
+			for (size_t i = 0; i < PACK_TEST_LEDS; i++) {
+				mismatches += packed[i] != (i < count ? expected[i] : 0xaa);
+			}
+
+			led_unpack(count, packed, state_out, color_out, brightness_out);
+
+			for (size_t i = 0; i < count; i++) {
+				mismatches += state_out[i] != (state[i] & 0x1);
+				mismatches += color_out[i] != (color[i] & 0x7);
+				mismatches += brightness_out[i] != (brightness[i] & 0xf);
+			}
+
+			status |= assert_size_eq(mismatches, 0, led_pack_implementation_name(implementation));
+		}
+	}
+
+	return status;
+}
+
+/// State of a reader thread of the frame stress test.
+typedef struct {
+	/// Set by the writer once all frames are published.
+	atomic_bool* done;
+	/// Number of acquired frames.
+	size_t frames;
+	/// Number of acquired frames which where not uniform (torn).
+	size_t torn;
+} FrameStressReader;
+
+/// Reader thread of the frame stress test; every published frame is uniform.
+///
+/// @param arg The #FrameStressReader of the thread.
+int frame_stress_reader(void* arg) {
+	FrameStressReader* reader = arg;
+
+	while (!atomic_load(reader->done)) {
+		const uint8_t* frame = led_frame_acquire();
+		uint8_t first = frame[0];
+
+		for (size_t i = 1; i < LED_BANK_SIZE; i++) {
+			if (frame[i] != first) {
+				reader->torn++;
+				break;
+			}
+		}
+
+		led_frame_release(frame);
+		reader->frames++;
+		// Give the writer a chance on machines with few cores.
+		thrd_yield();
+	}
+
+	return 0;
+}
+
+/// Tests for the double buffered frames (led_frame.h / led_frame.c).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_frame() {
+	printf("Running frame tests\n");
+
+	int status = 0;
+
+	led_bank_clear();
+	led_frame_init();
+
+	// Compose in the back frame, the front frame and LED_BANK are unchanged
+	const uint8_t* front = led_frame_acquire();
+	led_frame_release(front);
+
+	status |= assert_size_eq(led_frame_begin(), true, "frame: Begin");
+	led_bank_settings_set_range(0, 4, LED_COLOR_RED, LED_BRIGHTNESS_MAX);
+	led_bank_state_on(1);
+	status |= assert_register_bits(front[1], 0, "frame: Front unchanged");
+	status |= assert_bank_bits(1, 0, "frame: Bank unchanged");
+
+	// The swap publishes the frame into LED_BANK with a single registers write
+	uint32_t sequence = atomic_load(&registers_active->sequence);
+	led_frame_swap();
+	status |= assert_size_eq(atomic_load(&registers_active->sequence), sequence + 2, "frame: Published with a single write");
+	front = led_frame_acquire();
+	status |= assert_register_bits(front[0], 11110010, "frame: Swapped (0)");
+	status |= assert_register_bits(front[1], 11110011, "frame: Swapped (1)");
+	status |= assert_register_bits(front[4], 0, "frame: Swapped (4)");
+	status |= assert_bank_bits(1, 11110011, "frame: Published (1)");
+	status |= assert_bank_bits(4, 0, "frame: Published (4)");
+
+	// Bank functions change LED_BANK again after the swap
+	led_bank_state_on(2);
+	status |= assert_bank_bits(2, 11110011, "frame: Bank after swap");
+	status |= assert_register_bits(front[2], 11110010, "frame: Front after swap");
+
+	// The next frame starts from LED_BANK (including the change after the swap); the old front is free
+	status |= assert_size_eq(led_frame_begin(), true, "frame: Begin (2)");
+	led_bank_state_off(1);
+	led_frame_swap();
+	led_frame_release(front);
+
+	front = led_frame_acquire();
+	status |= assert_register_bits(front[0], 11110010, "frame: Kept (0)");
+	status |= assert_register_bits(front[1], 11110010, "frame: Changed (1)");
+	status |= assert_register_bits(front[2], 11110011, "frame: Kept bank change (2)");
+
+	// A frame which is still read can not be composed
+	status |= assert_size_eq(led_frame_begin(), true, "frame: Begin (3)");
+	led_frame_swap();
+	status |= assert_size_eq(led_frame_begin(), false, "frame: Begin while read");
+	led_frame_release(front);
+	status |= assert_size_eq(led_frame_begin(), true, "frame: Begin after release");
+	led_frame_swap();
+
+	// Concurrent readers never see a partial frame (all frames are uniform)
+	led_bank_clear();
+	led_frame_init();
+
+	atomic_bool done = false;
+	FrameStressReader readers[FRAME_STRESS_READERS];
+	thrd_t threads[FRAME_STRESS_READERS];
+
+	for (int i = 0; i < FRAME_STRESS_READERS; i++) {
+		readers[i] = (FrameStressReader){ &done, 0, 0 };
+
+		if (thrd_create(&threads[i], frame_stress_reader, &readers[i]) != thrd_success) {
+			printf("Failed to create thread %d\n", i);
+			return 1;
+		}
+	}
+
+	for (size_t frame = 0; frame < FRAME_STRESS_FRAMES; frame++) {
+		while (!led_frame_begin()) {
+			thrd_yield();
+		}
+
+		led_bank_brightness_set_range(0, LED_BANK_SIZE, (uint8_t)frame);
+		led_bank_state_set_range(0, LED_BANK_SIZE, (frame >> 4) & 0x1);
+		led_frame_swap();
+	}
+
+	atomic_store(&done, true);
+
+	for (int i = 0; i < FRAME_STRESS_READERS; i++) {
+		thrd_join(threads[i], NULL);
+		status |= assert_size_eq(readers[i].torn, 0, "frame: Torn frames");
+	}
+
+	led_bank_clear();
+
+	return status;
+}
+
+/// Tests for the led presets and scenes (led_preset.h / led_preset.c).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_preset() {
+	printf("Running preset tests\n");
+
+	int status = 0;
+
+	led_clear();
+
+	// Store the current value and a given value
+	uint8_t msg_settings[] = { MSG_OP_CODE_LED_SETTINGS, LED_COLOR_BLUE, 0x3 };
+	uint8_t msg_store[]    = { MSG_OP_CODE_PRESET_STORE, 0x2 };
+	uint8_t msg_store_value[] = { MSG_OP_CODE_PRESET_STORE_VALUE, 0xf, 0xf3 };
+	process_message(sizeof(msg_settings), msg_settings);
+	status |= assert_msg_process(process_message(sizeof(msg_store), msg_store), 0, "preset: Store");
+	status |= assert_msg_process(process_message(sizeof(msg_store_value), msg_store_value), 0, "preset: Store value");
+	led_clear();
+
+	// Single byte recall
+	uint8_t msg_recall[] = { MSG_OP_CODE_PRESET_RECALL + 0x2 };
+	status |= assert_msg_process(process_message(sizeof(msg_recall), msg_recall), 0, "preset: Recall (2)");
+	status |= assert_led_bits(111000, "preset: Recall (2)");
+	msg_recall[0] = MSG_OP_CODE_PRESET_RECALL + 0xf;
+	status |= assert_msg_process(process_message(sizeof(msg_recall), msg_recall), 0, "preset: Recall (15)");
+	status |= assert_led_bits(11110011, "preset: Recall (15)");
+	status |= assert_size_eq(msg_frame_length(MSG_OP_CODE_PRESET_RECALL + 0xf), 1, "preset: Recall length");
+
+	// Invalid slots
+	msg_store[1] = LED_PRESET_SLOTS;
+	status |= assert_msg_process(process_message(sizeof(msg_store), msg_store), MSG_ERROR_CODE_INVALID_PARAMETERS, "preset: Invalid slot");
+	status |= assert_size_eq(led_preset_recall(LED_PRESET_SLOTS), false, "preset: Invalid recall");
+
+	// Scenes
+	led_bank_clear();
+	led_bank_settings_set_range(10, 4, LED_COLOR_GREEN, 0x5);
+	led_bank_state_on(11);
+
+	uint8_t msg_scene_store[]  = { MSG_OP_CODE_SCENE_STORE, 0x1, 10, 0, 4 };
+	uint8_t msg_scene_recall[] = { MSG_OP_CODE_SCENE_RECALL, 0x1 };
+	status |= assert_msg_process(process_message(sizeof(msg_scene_store), msg_scene_store), 0, "preset: Scene store");
+	led_bank_clear();
+	status |= assert_msg_process(process_message(sizeof(msg_scene_recall), msg_scene_recall), 0, "preset: Scene recall");
+	status |= assert_bank_bits(9, 0, "preset: Scene recall (before)");
+	status |= assert_bank_bits(10, 1010100, "preset: Scene recall (first)");
+	status |= assert_bank_bits(11, 1010101, "preset: Scene recall (on)");
+	status |= assert_bank_bits(13, 1010100, "preset: Scene recall (last)");
+	status |= assert_bank_bits(14, 0, "preset: Scene recall (after)");
+
+	// Groups reaching past the end of the bank are truncated
+	led_bank_brightness_max(LED_BANK_SIZE - 1);
+	status |= assert_size_eq(led_preset_scene_store(0, LED_BANK_SIZE - 1, LED_PRESET_SCENE_SIZE), true, "preset: Scene truncated");
+	led_bank_clear();
+	led_preset_scene_recall(0);
+	status |= assert_bank_bits(LED_BANK_SIZE - 1, 11110000, "preset: Scene truncated");
+
+	msg_scene_store[4] = LED_PRESET_SCENE_SIZE + 1;
+	status |= assert_msg_process(process_message(sizeof(msg_scene_store), msg_scene_store), MSG_ERROR_CODE_INVALID_PARAMETERS, "preset: Scene too large");
+	msg_scene_recall[1] = LED_PRESET_SCENES;
+	status |= assert_msg_process(process_message(sizeof(msg_scene_recall), msg_scene_recall), MSG_ERROR_CODE_INVALID_PARAMETERS, "preset: Invalid scene");
+
+	led_clear();
+	led_bank_clear();
+
+	return status;
+}
+
+/// State of the reader thread of the registers stress test.
+typedef struct {
+	/// Set by the writer once all writes are done.
+	atomic_bool* done;
+	/// The registers to read.
+	const Registers* block;
+	/// Number of snapshots.
+	size_t snapshots;
+	/// Number of snapshots which where not uniform (torn).
+	size_t torn;
+} RegistersStressReader;
+
+/// Reader thread of the registers stress test; every bank write is uniform.
+///
+/// @param arg The #RegistersStressReader of the thread.
+int registers_stress_reader(void* arg) {
+	RegistersStressReader* reader = arg;
+	static RegistersSnapshot snapshot;
+
+	while (!atomic_load(reader->done)) {
+		if (registers_snapshot(reader->block, &snapshot)) {
+			for (size_t i = 1; i < LED_BANK_SIZE; i++) {
+				if (snapshot.bank[i] != snapshot.bank[0]) {
+					reader->torn++;
+					break;
+				}
+			}
+
+			reader->snapshots++;
+		}
+
+		// Give the writer a chance on machines with few cores.
+		thrd_yield();
+	}
+
+	return 0;
+}
+
+/// Tests for the registers and the shared register backend (registers.h / registers_shm.h).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_registers() {
+	printf("Running registers tests\n");
+
+	int status = 0;
+	static RegistersSnapshot snapshot;
+	const char* path = "registers_test.bin";
+
+	led_init();
+	led_bank_clear();
+	led_state_on();
+	led_bank_state_on(3);
+
+	// Every write advances the sequence counter by two
+	uint32_t sequence = atomic_load(&registers_active->sequence);
+	led_color_set(LED_COLOR_GREEN);
+	status |= assert_size_eq(atomic_load(&registers_active->sequence), sequence + 2, "registers: Led write counted");
+	led_bank_state_on(4);
+	status |= assert_size_eq(atomic_load(&registers_active->sequence), sequence + 4, "registers: Bank write counted");
+
+	// Map a file, the current values are kept
+	uint8_t led = LED;
+	remove(path);
+	status |= assert_size_eq(registers_shm_attach(REGISTERS_SHM_FILE, path) == NULL, true, "registers: Attach missing");
+	status |= assert_size_eq(registers_shm_map(REGISTERS_SHM_FILE, path), true, "registers: Map");
+	status |= assert_size_eq(LED, led, "registers: Mapped led");
+	status |= assert_bank_bits(3, 1, "registers: Mapped bank");
+
+	// Writes are visible through a second (read only) mapping
+	const Registers* shared = registers_shm_attach(REGISTERS_SHM_FILE, path);
+	status |= assert_size_eq(shared != NULL, true, "registers: Attach");
+
+	if (shared != NULL) {
+		led_state_off();
+		led_bank_state_on(5);
+		status |= assert_size_eq(shared->led, LED, "registers: Shared led");
+		status |= assert_size_eq(registers_snapshot(shared, &snapshot), true, "registers: Snapshot");
+		status |= assert_size_eq(snapshot.sequence & 0x1, 0, "registers: Snapshot sequence");
+		status |= assert_size_eq(snapshot.led, LED, "registers: Snapshot led");
+		status |= assert_register_bits(snapshot.bank[5], 1, "registers: Snapshot bank");
+
+		// Concurrent snapshots never see a partial bank write
+		atomic_bool done = false;
+		RegistersStressReader reader = { &done, shared, 0, 0 };
+		thrd_t thread;
+
+		led_bank_clear();
+
+		if (thrd_create(&thread, registers_stress_reader, &reader) != thrd_success) {
+			printf("Failed to create thread\n");
+			return 1;
+		}
+
+		for (size_t i = 0; i < REGISTERS_STRESS_WRITES; i++) {
+			led_bank_brightness_set_range(0, LED_BANK_SIZE, (uint8_t)i);
+		}
+
+		atomic_store(&done, true);
+		thrd_join(thread, NULL);
+		status |= assert_size_eq(reader.torn, 0, "registers: Torn snapshots");
+
+		registers_shm_detach(shared);
+	}
+
+	// Unmapping copies the values back into process memory
+	led = LED;
+	registers_shm_unmap();
+	status |= assert_size_eq(LED, led, "registers: Unmapped led");
+	status |= assert_size_eq(LED_BANK[0], ((REGISTERS_STRESS_WRITES - 1) & LED_BRIGHTNESS_VALUE_MASK) << LED_BRIGHTNESS_OFFSET, "registers: Unmapped bank");
+
+	// A region left during a write (odd sequence) is usable again after mapping it
+	status |= assert_size_eq(registers_shm_map(REGISTERS_SHM_FILE, path), true, "registers: Remap");
+	atomic_store(&registers_active->sequence, 7);
+	registers_shm_unmap();
+	status |= assert_size_eq(registers_shm_map(REGISTERS_SHM_FILE, path), true, "registers: Remap interrupted");
+	status |= assert_size_eq(atomic_load(&registers_active->sequence) & 0x1, 0, "registers: Remap sequence");
+	shared = registers_shm_attach(REGISTERS_SHM_FILE, path);
+	status |= assert_size_eq(shared != NULL && registers_snapshot(shared, &snapshot), true, "registers: Remap snapshot");
+	registers_shm_detach(shared);
+	registers_shm_unmap();
+
+	// A region with an invalid header can not be attached
+	FILE* file = fopen(path, "r+b");
+
+	if (file != NULL) {
+		fputc('X', file);
+		fclose(file);
+	}
+
+	status |= assert_size_eq(registers_shm_attach(REGISTERS_SHM_FILE, path) == NULL, true, "registers: Attach invalid");
+
+	remove(path);
+	led_init();
+	led_bank_clear();
+
+	return status;
+}
+
+/// Unit/Integration tests for the persistent snapshots (led_snapshot.h / led_snapshot.c).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_snapshot() {
+	printf("Running snapshot tests\n");
+
+	int status = 0;
+	static uint8_t snapshot[LED_SNAPSHOT_SIZE];
+	const char* path = "snapshot_test.bin";
+
+	// Check value of the CRC-32
+	status |= assert_size_eq(led_snapshot_crc32(9, (const uint8_t*)"123456789"), 0xcbf43926, "snapshot: CRC-32");
+
+	// State to save (blinking, on for ticks 100 - 104)
+	led_init();
+	led_bank_clear();
+	led_effect_stop();
+	led_tick(100);
+	led_value_set(board_layout(0xa5));
+	led_bank_state_on(7);
+	led_bank_color_set(LED_BANK_SIZE - 1, LED_COLOR_BLUE);
+	led_preset_store(3, board_layout(0x5b));
+	led_preset_scene_store(1, 6, 2);
+	led_effect_blink(10);
+	led_tick(103);
+	uint8_t led = LED;
+	status |= assert_size_eq(led_snapshot_encode(snapshot), true, "snapshot: Encode");
+
+	// Decoding restores everything
+	led_init();
+	led_bank_clear();
+	led_effect_stop();
+	led_preset_store(3, 0x00);
+	led_preset_scene_store(1, 0, 0);
+	status |= assert_size_eq(led_snapshot_decode(LED_SNAPSHOT_SIZE, snapshot), true, "snapshot: Decode");
+	status |= assert_size_eq(LED, led, "snapshot: Led");
+	status |= assert_bank_bits(7, 1, "snapshot: Bank");
+	status |= assert_bank_bits(LED_BANK_SIZE - 1, 1000, "snapshot: Bank (last)");
+	status |= assert_size_eq(led_effect_active(), true, "snapshot: Effect active");
+	led_tick(105);
+	status |= assert_led_bits(10100100, "snapshot: Effect continues");
+	led_effect_stop();
+	led_preset_recall(3);
+	status |= assert_size_eq(LED, board_layout(0x5b), "snapshot: Preset");
+	led_bank_clear();
+	led_preset_scene_recall(1);
+	status |= assert_bank_bits(7, 1, "snapshot: Scene");
+
+	// Invalid snapshots are rejected without changes
+	led_init();
+	snapshot[LED_SNAPSHOT_HEADER_SIZE + 1 + 7] ^= 0x1;
+	status |= assert_size_eq(led_snapshot_decode(LED_SNAPSHOT_SIZE, snapshot), false, "snapshot: Checksum");
+	snapshot[LED_SNAPSHOT_HEADER_SIZE + 1 + 7] ^= 0x1;
+	snapshot[4] = LED_SNAPSHOT_VERSION + 1;
+	status |= assert_size_eq(led_snapshot_decode(LED_SNAPSHOT_SIZE, snapshot), false, "snapshot: Version");
+	snapshot[4] = LED_SNAPSHOT_VERSION;
+	status |= assert_size_eq(led_snapshot_decode(LED_SNAPSHOT_SIZE - 1, snapshot), false, "snapshot: Length");
+	status |= assert_led_bits(0, "snapshot: Rejected");
+
+	// Files
+	remove(path);
+	led_value_set(led);
+	status |= assert_size_eq(led_snapshot_save(path), true, "snapshot: Save");
+	led_init();
+	led_bank_clear();
+	status |= assert_size_eq(led_snapshot_load(path), true, "snapshot: Load");
+	status |= assert_size_eq(LED, led, "snapshot: Loaded led");
+	status |= assert_bank_bits(7, 1, "snapshot: Loaded bank");
+
+	// Corrupt or missing files clear the leds
+	FILE* file = fopen(path, "wb");
+
+	if (file != NULL) {
+		fwrite(snapshot, 1, LED_SNAPSHOT_SIZE / 2, file);
+		fclose(file);
+	}
+
+	status |= assert_size_eq(led_snapshot_load(path), false, "snapshot: Load truncated");
+	status |= assert_led_bits(0, "snapshot: Truncated cleared");
+	status |= assert_bank_bits(7, 0, "snapshot: Truncated cleared bank");
+	remove(path);
+	led_value_set(led);
+	status |= assert_size_eq(led_snapshot_load(path), false, "snapshot: Load missing");
+	status |= assert_led_bits(0, "snapshot: Missing cleared");
+
+	led_effect_stop();
+	led_bank_clear();
+
+	return status;
+}
+
+/// Number of leds of the registers of the apply tests (many shards).
+#define APPLY_TEST_LEDS (9 * LED_APPLY_SHARD_LEDS + 123)
+/// Number of updates of the apply tests.
+#define APPLY_TEST_UPDATES 20000
+
+/// Unit/Integration tests for the (parallel) frame apply (led_apply.h / led_apply.c).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_apply() {
+	printf("Running apply tests\n");
+
+	int status = 0;
+	// Misaligned registers with a guard byte on each side.
+	static uint8_t serial[APPLY_TEST_LEDS + 2];
+	static uint8_t parallel[APPLY_TEST_LEDS + 5];
+	static LedUpdate updates[APPLY_TEST_UPDATES];
+	uint8_t* registers = &parallel[3];
+	uint32_t random = 0x2545f491;
+	uint32_t led = 0;
+
+	// Dense updates at the start, sparse ones after, some leds twice and a few
+	// outside of the registers.
+	for (size_t i = 0; i < APPLY_TEST_UPDATES; i++) {
+		random ^= random << 13;
+		random ^= random >> 17;
+		random ^= random << 5;
+
+		led += i < APPLY_TEST_UPDATES / 2 ? random % 2 : random % 16;
+		updates[i] = (LedUpdate){ .led = led, .mask = (uint8_t)(random >> 8), .value = (uint8_t)(random >> 16) };
+	}
+
+	status |= assert_size_eq(updates[APPLY_TEST_UPDATES - 1].led >= APPLY_TEST_LEDS, true, "apply: Updates outside");
+
+	size_t threads[] = { 1, 2, 4, 7 };
+
+	for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+		for (size_t i = 0; i < sizeof(serial); i++) {
+			serial[i] = (uint8_t)i;
+		}
+
+		for (size_t i = 0; i < sizeof(parallel); i++) {
+			parallel[i] = (uint8_t)(i - 2);
+		}
+
+		status |= assert_size_eq(led_apply_pool_start(threads[t]), true, "apply: Start pool");
+		status |= assert_size_eq(led_apply_pool_threads(), threads[t], "apply: Pool threads");
+
+		// Two frames, the pool is reused.
+		for (int frame = 0; frame < 2; frame++) {
+			led_apply_registers(&serial[1], APPLY_TEST_LEDS, updates, APPLY_TEST_UPDATES);
+			led_apply_registers_parallel(registers, APPLY_TEST_LEDS, updates, APPLY_TEST_UPDATES);
+		}
+
+		size_t mismatches = 0;
+
+		for (size_t i = 0; i < APPLY_TEST_LEDS; i++) {
+			mismatches += serial[i + 1] != registers[i];
+		}
+
+		status |= assert_size_eq(mismatches, 0, "apply: Parallel matches serial");
+		status |= assert_size_eq(registers[-1], 0, "apply: Guard before");
+		status |= assert_size_eq(registers[APPLY_TEST_LEDS], (uint8_t)(APPLY_TEST_LEDS + 1), "apply: Guard after");
+	}
+
+	// Led bank (through the pool)
+	LedUpdate bank[] = {
+		{ 3, LED_STATE_MASK, LED_STATE_MASK },
+		{ 3, LED_COLOR_MASK, LED_COLOR_BLUE << LED_COLOR_OFFSET },
+		{ LED_BANK_SIZE - 1, LED_BRIGHTNESS_MASK, LED_BRIGHTNESS_MAX << LED_BRIGHTNESS_OFFSET },
+		{ LED_BANK_SIZE, 0xff, 0xff },
+	};
+	uint32_t sequence = atomic_load(&registers_active->sequence);
+
+	led_bank_clear();
+	led_apply_bank(bank, sizeof(bank) / sizeof(bank[0]));
+	status |= assert_bank_bits(3, 1001, "apply: Bank");
+	status |= assert_bank_bits(LED_BANK_SIZE - 1, 11110000, "apply: Bank (last)");
+	status |= assert_size_eq(atomic_load(&registers_active->sequence), sequence + 4, "apply: Bank single write");
+
+	led_apply_pool_stop();
+	status |= assert_size_eq(led_apply_pool_threads(), 1, "apply: Stop pool");
+	status |= assert_size_eq(led_apply_pool_start(0), false, "apply: Invalid pool");
+	led_bank_clear();
+
+	return status;
+}
+
+/// Tests for the register layout of the board (board.h / led.h).
+///
+/// @return `0` if every test succeeded, `1` otherwise.
+int test_board() {
+	printf("Running board tests (%s)\n", LED_BOARD_NAME);
+
+	int status = 0;
+	size_t mismatches = 0;
+
+	// The sections cover all bits of the register exactly once
+	status |= assert_size_eq(LED_STATE_MASK ^ LED_COLOR_MASK ^ LED_BRIGHTNESS_MASK, 0xff, "board: Sections");
+
+	for (unsigned value = 0; value <= 0xff; value++) {
+		mismatches += default_layout(board_layout((uint8_t)value)) != value;
+	}
+
+	status |= assert_size_eq(mismatches, 0, "board: Layout round trip");
+
+	// Every setter only changes its own section
+	for (uint8_t value = 0; value <= LED_BRIGHTNESS_MAX; value++) {
+		led_clear();
+		led_state_set(value & LED_STATE_VALUE_MASK);
+		mismatches += LED != ((value & LED_STATE_VALUE_MASK) << LED_STATE_OFFSET);
+
+		led_clear();
+		led_color_set(value & LED_COLOR_VALUE_MASK);
+		mismatches += LED != ((value & LED_COLOR_VALUE_MASK) << LED_COLOR_OFFSET);
+
+		led_clear();
+		led_brightness_set(value);
+		mismatches += LED != (value << LED_BRIGHTNESS_OFFSET);
+	}
+
+	status |= assert_size_eq(mismatches, 0, "board: Setters");
+
+	led_clear();
+
+	return status;
+}
+
 int main(void) {
-	printf("Led count for target mc: %d\n", _LED_COUNT);
+	printf("Led count for target mc %s: %d\n", LED_BOARD_NAME, LED_BOARD_LEDS);
 
 	int status = 0;
 
+	status |= test_board();
 	status |= test_led();
+	status |= test_led_bank();
+	status |= test_led_atomic();
 	status |= test_msg();
+	status |= test_msg_stream();
+	status |= test_msg_batch();
+	status |= test_msg_queue();
+	status |= test_msg_coalesce();
+	status |= test_msg_sched();
+	status |= test_stats();
+	status |= test_trace();
+	status |= test_effect();
+	status |= test_preset();
+	status |= test_pack();
+	status |= test_frame();
+	status |= test_registers();
+	status |= test_snapshot();
+	status |= test_apply();
 
 	return status;
 }
@@ -0,0 +1,186 @@
+//! \file trace.c
+//! Implementation for the register write recorder.
+//!
+//! See trace.h for the available functions and documentation.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "trace.h"
+
+_Static_assert((TRACE_CAPACITY & (TRACE_CAPACITY - 1)) == 0, "TRACE_CAPACITY must be a power of two");
+
+#ifdef LED_TRACE
+
+/// The ring buffer.
+TraceEntry trace_entries[TRACE_CAPACITY];
+/// Number of started writes (the next entry is `trace_head % TRACE_CAPACITY`).
+atomic_uint_fast32_t trace_head;
+/// The op code of the message which is currently processed by this thread.
+_Thread_local uint16_t trace_op_code = TRACE_NO_OP_CODE;
+
+bool trace_enabled(void) {
+	return true;
+}
+
+/// Returns the current time of a monotonic clock in nanoseconds.
+uint64_t trace_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void trace_register_write(uint8_t value, uint8_t mask) {
+	// Claim a slot; concurrent writers get different slots.
+	uint_fast32_t index = atomic_fetch_add_explicit(&trace_head, 1, memory_order_relaxed);
+	TraceEntry* entry = &trace_entries[index & (TRACE_CAPACITY - 1)];
+
+	// Mark the entry as being written while its fields are updated.
+	atomic_store_explicit(&entry->sequence, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	entry->timestamp = trace_now();
+	entry->value     = value;
+	entry->mask      = mask;
+	entry->op_code   = trace_op_code;
+
+	atomic_store_explicit(&entry->sequence, index + 1, memory_order_release);
+}
+
+void trace_op_code_set(uint16_t op_code) {
+	trace_op_code = op_code;
+}
+
+void trace_reset(void) {
+	for (size_t i = 0; i < TRACE_CAPACITY; i++) {
+		atomic_store_explicit(&trace_entries[i].sequence, 0, memory_order_relaxed);
+	}
+
+	atomic_store_explicit(&trace_head, 0, memory_order_release);
+}
+
+size_t trace_count(void) {
+	return atomic_load_explicit(&trace_head, memory_order_acquire);
+}
+
+size_t trace_read(TraceEntry* entries, size_t capacity) {
+	uint_fast32_t head  = atomic_load_explicit(&trace_head, memory_order_acquire);
+	uint_fast32_t first = head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0;
+	size_t count = 0;
+
+	for (uint_fast32_t index = first; index < head && count < capacity; index++) {
+		TraceEntry* entry = &trace_entries[index & (TRACE_CAPACITY - 1)];
+
+		// Only take the entry if it was not (re)written while it was copied.
+		uint_fast32_t sequence = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+		TraceEntry* copy = &entries[count];
+
+		copy->timestamp = entry->timestamp;
+		copy->value     = entry->value;
+		copy->mask      = entry->mask;
+		copy->op_code   = entry->op_code;
+
+		atomic_thread_fence(memory_order_acquire);
+
+		if (sequence != index + 1 || atomic_load_explicit(&entry->sequence, memory_order_relaxed) != sequence) {
+			continue;
+		}
+
+		atomic_init(&copy->sequence, sequence);
+		count++;
+	}
+
+	return count;
+}
+
+/// Writes `value` as little endian into `buffer`.
+///
+/// @param buffer The buffer to write to.
+/// @param value The value to write.
+/// @param size The number of bytes to write.
+void trace_put_le(uint8_t* buffer, uint64_t value, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		buffer[i] = (uint8_t)(value >> (8 * i));
+	}
+}
+
+long trace_dump(const char* path) {
+	static TraceEntry entries[TRACE_CAPACITY];
+	size_t count = trace_read(entries, TRACE_CAPACITY);
+
+	FILE* file = fopen(path, "wb");
+
+	if (file == NULL) {
+		return -1;
+	}
+
+	uint8_t header[12] = { 'L', 'T', 'R', 'C' };
+	trace_put_le(&header[4], TRACE_DUMP_VERSION, 2);
+	trace_put_le(&header[6], TRACE_DUMP_ENTRY_SIZE, 2);
+	trace_put_le(&header[8], count, 4);
+
+	bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+	for (size_t i = 0; ok && i < count; i++) {
+		uint8_t record[TRACE_DUMP_ENTRY_SIZE];
+
+		trace_put_le(&record[0], entries[i].timestamp, 8);
+		record[8] = entries[i].value;
+		record[9] = entries[i].mask;
+		trace_put_le(&record[10], entries[i].op_code, 2);
+
+		ok = fwrite(record, sizeof(record), 1, file) == 1;
+	}
+
+	if (fclose(file) != 0) {
+		ok = false;
+	}
+
+	return ok ? (long)count : -1;
+}
+
+#else
+
+// Not compiled in, everything is a no-op.
+
+bool trace_enabled(void) {
+	return false;
+}
+
+void trace_register_write(uint8_t value, uint8_t mask) {
+	(void)value;
+	(void)mask;
+}
+
+void trace_op_code_set(uint16_t op_code) {
+	(void)op_code;
+}
+
+void trace_reset(void) {
+}
+
+size_t trace_count(void) {
+	return 0;
+}
+
+size_t trace_read(TraceEntry* entries, size_t capacity) {
+	(void)entries;
+	(void)capacity;
+
+	return 0;
+}
+
+long trace_dump(const char* path) {
+	(void)path;
+
+	return -1;
+}
+
+#endif
@@ -0,0 +1,125 @@
+//! \file trace.h
+//!
+//! Recorder for writes of the led register.
+//!
+//! Every write of the led register by the library (set_led_bits(),
+//! led_clear(), led_commit() and the header only setters of led_inline.h) is
+//! appended to a preallocated ring buffer together with the written bits, a
+//! timestamp and the op code of the message which caused it. The most recent
+//! #TRACE_CAPACITY writes can be dumped into a compact binary file for offline
+//! analysis/replay.
+//!
+//! The recorder is only compiled in if `LED_TRACE` is defined when building the
+//! library (e.g. `make FEATURES=LED_TRACE`), otherwise all hooks compile to
+//! nothing. Recording is lock-free and never allocates or blocks.
+//!
+//! # Dump format
+//!
+//! All values are little endian.
+//!
+//! | Offset | Size | Description                                   |
+//! | ------ | ---- | --------------------------------------------- |
+//! | `0`    | `4`  | Magic `LTRC`                                  |
+//! | `4`    | `2`  | Version (#TRACE_DUMP_VERSION)                 |
+//! | `6`    | `2`  | Size of an entry (#TRACE_DUMP_ENTRY_SIZE)     |
+//! | `8`    | `4`  | Number of entries                             |
+//! | `12`   |      | Entries (oldest first)                        |
+//!
+//! Entry:
+//!
+//! | Offset | Size | Description                                          |
+//! | ------ | ---- | ---------------------------------------------------- |
+//! | `0`    | `8`  | Timestamp (monotonic clock, nanoseconds)             |
+//! | `8`    | `1`  | Written register value                               |
+//! | `9`    | `1`  | Mask of the bits set by the write                    |
+//! | `10`   | `2`  | Op code of the message (#TRACE_NO_OP_CODE if none)   |
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Number of writes kept in the ring buffer (must be a power of two).
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY 4096
+#endif
+
+/// Op code recorded for writes which where not caused by a message.
+#define TRACE_NO_OP_CODE 0xffff
+
+/// Version of the dump format.
+#define TRACE_DUMP_VERSION 1
+/// Size of a single entry in the dump.
+#define TRACE_DUMP_ENTRY_SIZE 12
+
+/// A recorded write of the led register.
+typedef struct {
+	/// Timestamp of the write (monotonic clock, nanoseconds).
+	uint64_t timestamp;
+	/// The written register value.
+	uint8_t value;
+	/// The bits set by the write.
+	uint8_t mask;
+	/// The op code of the message which caused the write (#TRACE_NO_OP_CODE if none).
+	uint16_t op_code;
+	/// Sequence number of the entry plus one (`0` while being written).
+	atomic_uint_fast32_t sequence;
+} TraceEntry;
+
+/// Returns if the recorder is compiled into the library.
+bool trace_enabled(void);
+
+/// Discards all recorded writes.
+///
+/// # NOTE
+/// Must not be called concurrently with writes of the led register.
+void trace_reset(void);
+
+/// Returns the number of writes recorded since the last reset (including the
+/// ones which where overwritten in the ring buffer).
+size_t trace_count(void);
+
+/// Copies the recorded writes (oldest first) into `entries`.
+///
+/// Entries which are currently being written are skipped.
+///
+/// @param entries Receives the entries.
+/// @param capacity Number of entries which fit into `entries`.
+///
+/// @return The number of copied entries.
+size_t trace_read(TraceEntry* entries, size_t capacity);
+
+/// Writes the recorded writes into a binary file (see the dump format above).
+///
+/// @param path Path of the file to create (or overwrite).
+///
+/// @return The number of dumped entries or `-1` if the file could not be written (or the recorder is not enabled).
+long trace_dump(const char* path);
+
+/*
+ * Hooks (used by the library)
+ */
+
+/// Records a write of the led register.
+///
+/// @param value The written register value.
+/// @param mask The bits set by the write.
+void trace_register_write(uint8_t value, uint8_t mask);
+
+/// Sets the op code recorded for the following writes of the calling thread.
+///
+/// @param op_code The op code or #TRACE_NO_OP_CODE.
+void trace_op_code_set(uint16_t op_code);
+
+#ifdef LED_TRACE
+#define TRACE_REGISTER_WRITE(value, mask) trace_register_write(value, mask)
+#define TRACE_OP_CODE_SET(op_code)        trace_op_code_set(op_code)
+#else
+#define TRACE_REGISTER_WRITE(value, mask) ((void)(value), (void)(mask))
+#define TRACE_OP_CODE_SET(op_code)        ((void)(op_code))
+#endif
+
+#endif
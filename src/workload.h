@@ -0,0 +1,150 @@
+//! \file workload.h
+//!
+//! Synthetic message traffic and timing shared by the tools (bench.c,
+//! loadgen.c, pgo_train.c and replay.c).
+//!
+//! All tools generate their messages with workload_message(), so the mixes
+//! of the benchmarks, the load generator, the profile training and the
+//! synthetic captures can not drift apart:
+//!
+//! | Mix                   | Settings | On/Off | Malformed                                            | Used by                  |
+//! | --------------------- | -------- | ------ | ---------------------------------------------------- | ------------------------ |
+//! | #WORKLOAD_MIX_SERVER  | ~90%     | ~8%    | ~2% unknown op codes                                 | loadgen.c, pgo_train.c   |
+//! | #WORKLOAD_MIX_MIXED   | ~70%     | ~25%   | ~5% unknown op codes, missing params, trailing bytes | bench.c, replay.c        |
+//! | #WORKLOAD_MIX_VALID   | ~75%     | ~25%   | -                                                    | bench.c (streams)        |
+//!
+//! The generator is deterministic (xorshift32), every caller keeps its own
+//! state, so runs with the same seed produce the same traffic.
+//!
+//! # NOTE
+//! Header only, the functions are not part of the library. The including
+//! file must define `_POSIX_C_SOURCE` (for `clock_gettime()`).
+
+#ifndef _WORKLOAD_H_
+#define _WORKLOAD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "led.h"
+#include "msg.h"
+
+/// Maximum length of a generated message.
+#define WORKLOAD_MAX_LENGTH 4
+
+/// First of the unknown op codes which are generated as invalid messages
+/// (`0xe0` - `0xef`, never assigned by the protocol).
+#define WORKLOAD_UNKNOWN_OP_CODE 0xe0
+
+/// Mixes of generated messages.
+typedef enum {
+	/// Traffic of a server: mostly settings, some on/off and a few unknown op codes.
+	WORKLOAD_MIX_SERVER,
+	/// Mostly settings, some on/off and a few malformed messages.
+	WORKLOAD_MIX_MIXED,
+	/// #WORKLOAD_MIX_MIXED with settings instead of the malformed messages
+	/// (e.g. for byte streams, which can not express wrong lengths).
+	WORKLOAD_MIX_VALID,
+} WorkloadMix;
+
+/// Returns the current time of a monotonic clock in nanoseconds.
+static inline uint64_t workload_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/// Small deterministic pseudo random number generator (xorshift32).
+///
+/// @param state The state of the generator (must not be `0`).
+///
+/// @return The next random number.
+static inline uint32_t workload_random(uint32_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+/// Generates a settings message.
+static inline uint8_t workload_settings(uint32_t* state, uint8_t* message) {
+	message[0] = MSG_OP_CODE_LED_SETTINGS;
+	message[1] = workload_random(state) & LED_COLOR_VALUE_MASK;
+	message[2] = workload_random(state) & LED_BRIGHTNESS_VALUE_MASK;
+
+	return 3;
+}
+
+/// Generates a message with an unknown op code.
+static inline uint8_t workload_unknown(uint32_t* state, uint8_t* message, uint8_t* expected) {
+	message[0] = WORKLOAD_UNKNOWN_OP_CODE | (workload_random(state) & 0x0f);
+	*expected = MSG_ERROR_CODE_INVALID_OP_CODE;
+
+	return 1;
+}
+
+/// Generates a single message.
+///
+/// @param state The state of the generator.
+/// @param mix The mix of messages.
+/// @param message Receives the message (#WORKLOAD_MAX_LENGTH bytes).
+/// @param expected Receives the expected result of process_message() (`0` or a variant of #MsgErrorCode), may be `NULL`.
+///
+/// @return The length of the message.
+static inline uint8_t workload_message(uint32_t* state, WorkloadMix mix, uint8_t* message, uint8_t* expected) {
+	uint32_t kind = workload_random(state) % 100;
+	uint8_t ignored;
+
+	if (expected == NULL) {
+		expected = &ignored;
+	}
+
+	*expected = 0;
+
+	if (mix == WORKLOAD_MIX_SERVER) {
+		if (kind < 90) {
+			return workload_settings(state, message);
+		}
+
+		if (kind < 98) {
+			message[0] = kind & 0x1 ? MSG_OP_CODE_ON : MSG_OP_CODE_OFF;
+			return 1;
+		}
+
+		return workload_unknown(state, message, expected);
+	}
+
+	if (kind < 70 || (kind >= 95 && mix == WORKLOAD_MIX_VALID)) {
+		return workload_settings(state, message);
+	}
+
+	if (kind < 95) {
+		message[0] = kind & 0x1 ? MSG_OP_CODE_ON : MSG_OP_CODE_OFF;
+		return 1;
+	}
+
+	if (kind < 97) {
+		return workload_unknown(state, message, expected);
+	}
+
+	if (kind < 99) {
+		message[0] = MSG_OP_CODE_LED_SETTINGS;
+		message[1] = 0x00;
+		*expected = MSG_ERROR_CODE_MISSING_PARAMETERS;
+		return 1 + workload_random(state) % 2;
+	}
+
+	uint8_t length = 2 + workload_random(state) % 3;
+
+	message[0] = MSG_OP_CODE_ON;
+	memset(&message[1], 0, length - 1);
+	*expected = MSG_ERROR_CODE_TRAILING_BYTES;
+
+	return length;
+}
+
+#endif